@@ -94,7 +94,8 @@ public:
     void loadFen(const std::string& fen);
     
     // Inlined for linking
-    void loadPgn(const std::string& pgn);
+    // False if a movetext token was not a legal move; such tokens are skipped
+    bool loadPgn(const std::string& pgn);
     std::string moveToSan(const Move& m) const;
     Move parseSan(const std::string& san) const;
 
@@ -825,8 +826,9 @@ private:
         return false;
     }
 
-    inline void Board::loadPgn(const std::string& pgn) {
+    inline bool Board::loadPgn(const std::string& pgn) {
         reset();
+        bool parsed = true;
         std::string cleanPgn = pgn;
         for(char& c : cleanPgn) if (c == '\n' || c == '\r') c = ' ';
         
@@ -856,13 +858,18 @@ private:
              
              if (token.empty()) continue; 
              if (isdigit(token[0])) continue; 
+             if (token[0] == '$') continue; // NAG
              if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*") break; 
+             while (token.size() > 1 && (token.back() == '!' || token.back() == '?')) token.pop_back();
              
              Move m = parseSan(token);
              if (!m.isNull()) {
                  makeMove(m);
+             } else {
+                 parsed = false;
              }
         }
+        return parsed;
     }
 
 } // namespace Chess
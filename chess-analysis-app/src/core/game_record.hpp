@@ -12,7 +12,7 @@ public:
 
     void addMove(Move m, const std::string& san = "") {
         // If we differ from history (we are in past), truncate future
-        if (currentIndex < moves.size()) {
+        if (currentIndex < (int)moves.size()) {
             moves.resize(currentIndex);
             sanMoves.resize(currentIndex);
         }
@@ -28,7 +28,7 @@ public:
         currentIndex = 0;
     }
 
-    bool hasNext() const { return currentIndex < moves.size(); }
+    bool hasNext() const { return currentIndex < (int)moves.size(); }
     bool hasPrev() const { return currentIndex > 0; }
 
     Move next() {
@@ -41,18 +41,15 @@ public:
         return moves[--currentIndex];
     }
     
-    // Get full history for Stockfish "position startpos moves ..."
-    std::vector<std::string> getMoveStrings(const Board& startBoard) const {
-         // This is tricky if startpos is not standard.
-         // For now assume standard startpos or handle FEN + moves.
-         // Let's just return algebraic moves if possible, or coordinate notation.
-         // Stockfish speaks coordinate notation (e2e4) well.
-         std::vector<std::string> moveStrs;
-         // We might need a temp board to generate correct notations if we want SAN, 
-         // but for engine communication, coordinate notation (which we can derive from Move) is best.
-         // `Move` struct has indices, `squareToString` helper exists in board.hpp logic?
-
-         return moveStrs;
+    // Moves played up to the current position, in coordinate notation
+    // (e2e4), for Stockfish "position fen <start> moves ..."
+    std::vector<std::string> getMoveStrings() const {
+        std::vector<std::string> moveStrs;
+        moveStrs.reserve(currentIndex);
+        for (int i = 0; i < currentIndex && i < (int)moves.size(); i++) {
+            moveStrs.push_back(moves[i].toString());
+        }
+        return moveStrs;
     }
     
     // Store eval
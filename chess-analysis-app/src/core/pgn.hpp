@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <sstream>
+
+namespace Chess {
+
+// Value of a PGN tag pair, e.g. pgnTag(pgn, "Result") -> "1-0". Empty if absent.
+inline std::string pgnTag(const std::string& pgn, const std::string& tag) {
+    std::string key = "[" + tag + " \"";
+    size_t pos = pgn.find(key);
+    if (pos == std::string::npos) return "";
+    pos += key.size();
+    size_t end = pgn.find('"', pos);
+    if (end == std::string::npos) return "";
+    return pgn.substr(pos, end - pos);
+}
+
+// Splits a PGN database into single games. A game starts at its first tag
+// line following movetext; text without tags is one game.
+inline std::vector<std::string> splitPgnGames(const std::string& text) {
+    std::vector<std::string> games;
+    std::string current;
+    bool seenMoves = false;
+    std::istringstream in(text);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        bool isTag = !line.empty() && line[0] == '[';
+        if (isTag && seenMoves) {
+            games.push_back(current);
+            current.clear();
+            seenMoves = false;
+        }
+        if (!isTag && line.find_first_not_of(" \t") != std::string::npos) seenMoves = true;
+        current += line;
+        current += '\n';
+    }
+    if (current.find_first_not_of(" \t\n") != std::string::npos) games.push_back(current);
+    return games;
+}
+
+} // namespace Chess
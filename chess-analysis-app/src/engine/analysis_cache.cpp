@@ -0,0 +1,314 @@
+#include "analysis_cache.hpp"
+#include "../core/board.hpp"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Engine {
+
+namespace {
+
+constexpr uint32_t CACHE_MAGIC = 0x43414653; // "SFAC"
+constexpr uint32_t CACHE_VERSION = 3;
+
+struct CacheFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t count;
+};
+
+// FNV-1a over the first `fields` space-separated FEN fields
+uint64_t hashFenFields(const std::string& fen, int fields) {
+    uint64_t h = 1469598103934665603ULL;
+    int spaces = 0;
+    for (char c : fen) {
+        if (c == ' ' && ++spaces == fields) break;
+        h ^= (unsigned char)c;
+        h *= 1099511628211ULL;
+    }
+    return h ? h : 1; // 0 is reserved for "unknown position"
+}
+
+uint16_t packMove(const std::string& uci) {
+    Chess::Move m = Chess::Move::fromString(uci);
+    if (m.isNull() || m.dest == Chess::SQUARE_NONE) return 0;
+    return (uint16_t)(m.from | (m.dest << 6) | ((int)m.promotion << 12));
+}
+
+std::string unpackMove(uint16_t packed) {
+    Chess::Move m;
+    m.from = packed & 63;
+    m.dest = (packed >> 6) & 63;
+    m.promotion = (Chess::PieceType)((packed >> 12) & 7);
+    return m.toString();
+}
+
+// Falls back to the first move when the PV is empty
+uint8_t packPv(const std::vector<std::string>& pv, const std::string& first, uint16_t* out, int maxLength) {
+    std::vector<std::string> moves = pv;
+    if (moves.empty() && !first.empty()) moves.push_back(first);
+    uint8_t length = 0;
+    for (const auto& mv : moves) {
+        if (length == maxLength) break;
+        uint16_t packed = packMove(mv);
+        if (packed == 0) break;
+        out[length++] = packed;
+    }
+    return length;
+}
+
+std::vector<std::string> unpackPv(const uint16_t* pv, int length, int maxLength) {
+    std::vector<std::string> moves;
+    for (int i = 0; i < length && i < maxLength; i++) moves.push_back(unpackMove(pv[i]));
+    return moves;
+}
+
+float centipawnsOf(int score, bool isMate) {
+    if (isMate) return (score > 0) ? 30000.0f - score : -30000.0f - score;
+    return (float)score;
+}
+
+// Read-only / read-write views of a whole file
+struct MappedFile {
+    void* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    bool open(const std::string& path, size_t createSize) {
+        bool writable = createSize > 0;
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), writable ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ,
+                           FILE_SHARE_READ, NULL, writable ? CREATE_ALWAYS : OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        if (writable) {
+            size = createSize;
+        } else {
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize)) return false;
+            size = (size_t)fileSize.QuadPart;
+        }
+        if (size == 0) return false;
+        mapping = CreateFileMappingA(file, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+                                     (DWORD)((uint64_t)size >> 32), (DWORD)(size & 0xFFFFFFFF), NULL);
+        if (!mapping) return false;
+        data = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+        return data != nullptr;
+#else
+        fd = ::open(path.c_str(), writable ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDONLY, 0644);
+        if (fd < 0) return false;
+        if (writable) {
+            size = createSize;
+            if (ftruncate(fd, (off_t)size) != 0) return false;
+        } else {
+            struct stat st;
+            if (fstat(fd, &st) != 0) return false;
+            size = (size_t)st.st_size;
+        }
+        if (size == 0) return false;
+        data = mmap(nullptr, size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            data = nullptr;
+            return false;
+        }
+        return true;
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (data) {
+            FlushViewOfFile(data, 0);
+            UnmapViewOfFile(data);
+        }
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+        if (data) {
+            msync(data, size, MS_SYNC);
+            munmap(data, size);
+        }
+        if (fd >= 0) close(fd);
+#endif
+    }
+};
+
+} // namespace
+
+uint64_t positionKey(const std::string& fen) {
+    return hashFenFields(fen, 5);
+}
+
+uint64_t historyKey(const std::string& startFen, const std::vector<std::string>& moves) {
+    Chess::Board board(startFen);
+    // Repetitions compare placement, side, castling and en passant only
+    std::vector<uint64_t> seen = {hashFenFields(startFen, 4)};
+    for (const auto& m : moves) {
+        if (!board.makeMove(Chess::Move::fromString(m))) break;
+        uint64_t h = hashFenFields(board.getFen(), 4);
+        if (std::find(seen.begin(), seen.end(), h) != seen.end()) return 0;
+        seen.push_back(h);
+    }
+    return positionKey(moves.empty() ? startFen : board.getFen());
+}
+
+uint64_t searchKey(uint64_t position, int multiPv) {
+    if (position == 0 || multiPv <= 1) return position;
+    uint64_t h = (position ^ (uint64_t)multiPv) * 1099511628211ULL;
+    return h ? h : 1;
+}
+
+CacheRecord toRecord(uint64_t key, const EngineResult& result) {
+    CacheRecord rec;
+    rec.key = key;
+    rec.score = result.score;
+    rec.depth = (int16_t)result.depth;
+    rec.is_mate = result.is_mate ? 1 : 0;
+    rec.bound = (uint8_t)result.bound;
+    for (int i = 0; i < 3; i++) rec.wdl[i] = (uint16_t)result.wdl[i];
+    rec.pv_length = packPv(result.pv, result.best_move, rec.pv, CacheRecord::MAX_PV);
+
+    // The main line is the record itself; the others follow it
+    rec.line_count = (uint8_t)std::min<size_t>(result.lines.size(), CacheRecord::MAX_LINES);
+    for (int i = 1; i < rec.line_count; i++) {
+        const PvLine& src = result.lines[i];
+        CacheLine& dst = rec.lines[i - 1];
+        dst.score = src.score;
+        dst.depth = (int16_t)src.depth;
+        dst.is_mate = src.is_mate ? 1 : 0;
+        dst.pv_length = packPv(src.pv, src.move, dst.pv, CacheLine::MAX_PV);
+    }
+    return rec;
+}
+
+void fromRecord(const CacheRecord& rec, EngineResult& out) {
+    out = EngineResult{};
+    out.depth = rec.depth;
+    out.score = rec.score;
+    out.is_mate = rec.is_mate != 0;
+    out.bound = (ScoreBound)rec.bound;
+    for (int i = 0; i < 3; i++) out.wdl[i] = rec.wdl[i];
+    out.centipawns = centipawnsOf(rec.score, out.is_mate);
+    out.pv = unpackPv(rec.pv, rec.pv_length, CacheRecord::MAX_PV);
+    if (!out.pv.empty()) out.best_move = out.pv[0];
+
+    for (int i = 0; i < rec.line_count && i < CacheRecord::MAX_LINES; i++) {
+        PvLine line;
+        if (i == 0) {
+            line = {out.best_move, out.centipawns, out.score, out.is_mate, out.depth, out.pv};
+        } else {
+            const CacheLine& src = rec.lines[i - 1];
+            line.pv = unpackPv(src.pv, src.pv_length, CacheLine::MAX_PV);
+            if (!line.pv.empty()) line.move = line.pv[0];
+            line.score = src.score;
+            line.is_mate = src.is_mate != 0;
+            line.centipawns = centipawnsOf(src.score, line.is_mate);
+            line.depth = src.depth;
+        }
+        out.lines.push_back(line);
+    }
+}
+
+AnalysisCache::AnalysisCache(size_t cap) : capacity(cap ? cap : 1) {}
+
+bool AnalysisCache::lookup(uint64_t key, int minDepth, EngineResult& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it == index.end() || it->second->depth < minDepth) {
+        missCount++;
+        return false;
+    }
+    lru.splice(lru.begin(), lru, it->second);
+    fromRecord(*it->second, out);
+    hitCount++;
+    return true;
+}
+
+void AnalysisCache::store(uint64_t key, const EngineResult& result) {
+    if (result.lines.size() > (size_t)CacheRecord::MAX_LINES) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it != index.end()) {
+        lru.splice(lru.begin(), lru, it->second);
+        if (it->second->depth > result.depth) return;
+        *it->second = toRecord(key, result);
+        return;
+    }
+    insert(toRecord(key, result));
+}
+
+void AnalysisCache::insert(const CacheRecord& rec) {
+    lru.push_front(rec);
+    index[rec.key] = lru.begin();
+    while (lru.size() > capacity) {
+        index.erase(lru.back().key);
+        lru.pop_back();
+    }
+}
+
+size_t AnalysisCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lru.size();
+}
+
+void AnalysisCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    lru.clear();
+    index.clear();
+}
+
+bool AnalysisCache::load(const std::string& path) {
+    MappedFile file;
+    if (!file.open(path, 0)) return false;
+    if (file.size < sizeof(CacheFileHeader)) return false;
+
+    CacheFileHeader header;
+    std::memcpy(&header, file.data, sizeof(header));
+    if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION ||
+        header.recordSize != sizeof(CacheRecord)) return false;
+    if (file.size < sizeof(CacheFileHeader) + (size_t)header.count * sizeof(CacheRecord)) return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const char* records = static_cast<const char*>(file.data) + sizeof(CacheFileHeader);
+    // Stored least recent first, so pushing to the front restores LRU order
+    for (uint32_t i = 0; i < header.count; i++) {
+        CacheRecord rec;
+        std::memcpy(&rec, records + (size_t)i * sizeof(CacheRecord), sizeof(CacheRecord));
+        if (rec.key == 0 || index.count(rec.key)) continue;
+        insert(rec);
+    }
+    return true;
+}
+
+bool AnalysisCache::save(const std::string& path) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    CacheFileHeader header = { CACHE_MAGIC, CACHE_VERSION, (uint32_t)sizeof(CacheRecord), (uint32_t)lru.size() };
+
+    MappedFile file;
+    if (!file.open(path, sizeof(CacheFileHeader) + lru.size() * sizeof(CacheRecord))) return false;
+
+    char* out = static_cast<char*>(file.data);
+    std::memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    for (auto it = lru.rbegin(); it != lru.rend(); ++it) {
+        std::memcpy(out, &*it, sizeof(CacheRecord));
+        out += sizeof(CacheRecord);
+    }
+    return true;
+}
+
+} // namespace Engine
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include "stockfish.hpp"
+
+namespace Engine {
+
+// Hash of the FEN up to the fullmove number. The halfmove clock is part of
+// the key since the engine's scores drift towards the 50-move rule.
+uint64_t positionKey(const std::string& fen);
+// Key of the position reached by the moves, or 0 (not cacheable) if a
+// position repeats on the way: the engine may score it as a repetition draw.
+uint64_t historyKey(const std::string& startFen, const std::vector<std::string>& moves);
+// Key of a search in a position. Results depend on MultiPV, so every
+// setting has its own entries; MultiPV 1 uses the position key itself.
+uint64_t searchKey(uint64_t positionKey, int multiPv);
+
+// A MultiPV line after the first, packed like the record's own PV
+struct CacheLine {
+    static constexpr int MAX_PV = 12;
+
+    int32_t score = 0;
+    int16_t depth = 0;
+    uint8_t is_mate = 0;
+    uint8_t pv_length = 0;
+    uint16_t pv[MAX_PV] = {};
+};
+
+// Fixed-size record, stored as-is in the cache file
+struct CacheRecord {
+    static constexpr int MAX_PV = 24;
+    static constexpr int MAX_LINES = 4;     // main line included
+
+    uint64_t key = 0;
+    int32_t score = 0;      // centipawns, or mate distance when is_mate
+    int16_t depth = 0;
+    uint8_t is_mate = 0;
+    uint8_t bound = 0;      // ScoreBound
+    uint16_t wdl[3] = {0, 0, 0};
+    uint8_t pv_length = 0;
+    uint8_t line_count = 0; // MultiPV lines searched, main line included
+    uint16_t pv[MAX_PV] = {}; // from | dest << 6 | promotion << 12
+    CacheLine lines[MAX_LINES - 1] = {};
+};
+
+class AnalysisCache {
+public:
+    explicit AnalysisCache(size_t capacity = 100000);
+
+    // Returns true if an entry exists with at least minDepth
+    bool lookup(uint64_t key, int minDepth, EngineResult& out);
+    // Keeps the deeper of the stored and the new result. Results with more
+    // MultiPV lines than a record holds are not stored.
+    void store(uint64_t key, const EngineResult& result);
+
+    size_t size() const;
+    void clear();
+
+    // Persistence through a memory-mapped file. Records are written in
+    // LRU order so recency survives a reload.
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+
+    uint64_t hits() const { return hitCount; }
+    uint64_t misses() const { return missCount; }
+
+private:
+    size_t capacity;
+    std::list<CacheRecord> lru; // front = most recently used
+    std::unordered_map<uint64_t, std::list<CacheRecord>::iterator> index;
+    mutable std::mutex mutex;
+    uint64_t hitCount = 0;
+    uint64_t missCount = 0;
+
+    void insert(const CacheRecord& rec);
+};
+
+CacheRecord toRecord(uint64_t key, const EngineResult& result);
+void fromRecord(const CacheRecord& rec, EngineResult& out);
+
+} // namespace Engine
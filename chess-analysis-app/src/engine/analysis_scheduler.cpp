@@ -0,0 +1,233 @@
+#include "analysis_scheduler.hpp"
+
+namespace Engine {
+
+namespace {
+
+// A cached MultiPV line as the info line its search printed
+EngineResult lineInfo(const EngineResult& cached, size_t index) {
+    const PvLine& line = cached.lines[index];
+    EngineResult info;
+    info.multipv = (int)index + 1;
+    info.depth = line.depth;
+    info.score = line.score;
+    info.is_mate = line.is_mate;
+    info.centipawns = line.centipawns;
+    info.pv = line.pv;
+    info.best_move = line.move;
+    return info;
+}
+
+} // namespace
+
+AnalysisScheduler::AnalysisScheduler(StockfishClient& eng) : AnalysisScheduler(eng, Options{}) {}
+
+AnalysisScheduler::AnalysisScheduler(StockfishClient& eng, Options opts) : engine(eng), options(opts) {}
+
+AnalysisScheduler::~AnalysisScheduler() {
+    stop();
+}
+
+void AnalysisScheduler::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running) return;
+    running = true;
+    engine.setSearchCallback([this](uint64_t id, const EngineResult& info, bool final) {
+        onSearchOutput(id, info, final);
+    });
+    worker = std::thread(&AnalysisScheduler::workerLoop, this);
+}
+
+void AnalysisScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) return;
+        running = false;
+        active.id = 0;
+    }
+    cv.notify_all();
+    if (worker.joinable()) worker.join();
+    engine.setSearchCallback(nullptr);
+    engine.stopAnalysis();
+}
+
+uint64_t AnalysisScheduler::submit(const std::string& fen) {
+    return submit(fen, {});
+}
+
+uint64_t AnalysisScheduler::submit(const std::string& startFen, const std::vector<std::string>& moves) {
+    std::string fen = moves.empty() ? startFen : applyUciMoves(startFen, moves);
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (hasPending) metrics.coalesced++;
+        id = nextId++;
+        pending = Request{};
+        pending.id = id;
+        pending.fen = fen;
+        pending.startFen = startFen;
+        pending.moves = moves;
+        pending.submitted = Clock::now();
+        hasPending = true;
+        metrics.submitted++;
+    }
+    cv.notify_all();
+    return id;
+}
+
+void AnalysisScheduler::cancel() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        hasPending = false;
+        deepenRequested = false;
+        active.id = 0;
+    }
+    engine.stopAnalysis();
+}
+
+void AnalysisScheduler::replay() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running || hasPending || active.id == 0) return;
+        // The restarted engine lost the search; run the active request again
+        pending = active;
+        pending.quickPhase = true;
+        pending.submitted = Clock::now() - std::chrono::milliseconds(options.debounceMs);
+        hasPending = true;
+        deepenRequested = false;
+    }
+    cv.notify_all();
+}
+
+void AnalysisScheduler::setUpdateCallback(UpdateCallback cb) {
+    std::lock_guard<std::mutex> lock(mutex);
+    onUpdate = cb;
+}
+
+AnalysisScheduler::Metrics AnalysisScheduler::getMetrics() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return metrics;
+}
+
+void AnalysisScheduler::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running) {
+        if (hasPending) {
+            // Wait until submissions stop arriving for debounceMs
+            auto due = pending.submitted + std::chrono::milliseconds(options.debounceMs);
+            if (Clock::now() < due) {
+                cv.wait_until(lock, due);
+                continue;
+            }
+            startRequest(lock);
+        } else if (deepenRequested) {
+            deepen(lock);
+        } else {
+            cv.wait(lock);
+        }
+    }
+}
+
+// Engine calls are made with the lock released: the search callback runs
+// on the reader thread while the client holds its own mutex.
+void AnalysisScheduler::startRequest(std::unique_lock<std::mutex>& lock) {
+    active = pending;
+    hasPending = false;
+    deepenRequested = false;
+    Request req = active;
+    lock.unlock();
+
+    EngineResult cached;
+    bool hit = engine.cachedResult(req.startFen, req.moves, options.quickDepth, options.multiPv, cached);
+    // Entries are kept per MultiPV setting, so a hit has all the lines
+    bool complete = hit && cached.depth >= options.fullDepth;
+
+    if (hit) {
+        UpdateCallback cb;
+        std::vector<AnalysisUpdate> updates;
+        lock.lock();
+        if (active.id != req.id) return;
+        metrics.cacheHits++;
+        recordFirstEval(active);
+        active.quickPhase = false;
+        // Alternatives first, so the main line's update is the final one
+        for (size_t i = 1; i < cached.lines.size(); i++) {
+            updates.push_back({req.id, req.fen, lineInfo(cached, i), false, true});
+        }
+        updates.push_back({req.id, req.fen, cached, complete, true});
+        cb = onUpdate;
+        lock.unlock();
+        if (cb) {
+            for (const auto& update : updates) cb(update);
+        }
+    }
+
+    // stop + position + go reach the engine as one write
+    commands.stop();
+    if (!complete) {
+        if (req.moves.empty()) {
+            commands.position(req.fen);
+        } else {
+            engine.addGamePosition(commands, req.startFen, req.moves);
+        }
+        commands.go(limitsFor(hit ? options.fullDepth : options.quickDepth), req.id);
+    }
+    engine.send(commands);
+
+    lock.lock();
+    if (!complete) metrics.searchesStarted++;
+}
+
+void AnalysisScheduler::deepen(std::unique_lock<std::mutex>& lock) {
+    deepenRequested = false;
+    uint64_t id = active.id;
+    if (id == 0) return;
+    lock.unlock();
+    // Same position is still loaded in the engine
+    engine.send(commands.go(limitsFor(options.fullDepth), id));
+    lock.lock();
+    metrics.searchesStarted++;
+}
+
+SearchLimits AnalysisScheduler::limitsFor(int depth) const {
+    SearchLimits limits = SearchLimits::ofDepth(depth);
+    limits.multiPv = options.multiPv;
+    return limits;
+}
+
+void AnalysisScheduler::recordFirstEval(Request& req) {
+    if (req.firstEvalSeen) return;
+    req.firstEvalSeen = true;
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() - req.submitted).count();
+    metrics.firstEvalCount++;
+    metrics.firstEvalTotalMs += ms;
+    metrics.lastFirstEvalMs = ms;
+}
+
+void AnalysisScheduler::onSearchOutput(uint64_t requestId, const EngineResult& info, bool final) {
+    UpdateCallback cb;
+    AnalysisUpdate update;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (requestId == 0) return; // Not ours (e.g. game review)
+        if (requestId != active.id) {
+            metrics.staleDiscarded++;
+            return;
+        }
+        recordFirstEval(active);
+
+        bool done = final;
+        if (final && active.quickPhase) {
+            // Quick pass finished: continue with the full-depth search
+            active.quickPhase = false;
+            deepenRequested = true;
+            done = false;
+            cv.notify_all();
+        }
+        update = {requestId, active.fen, info, done, false};
+        cb = onUpdate;
+    }
+    if (cb) cb(update);
+}
+
+} // namespace Engine
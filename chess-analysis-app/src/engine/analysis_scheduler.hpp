@@ -0,0 +1,109 @@
+#pragma once
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "stockfish.hpp"
+
+namespace Engine {
+
+struct AnalysisUpdate {
+    uint64_t requestId = 0;
+    std::string fen;
+    EngineResult info;
+    bool final = false;     // last update for this request
+    bool fromCache = false;
+};
+
+// Sits between the GUI and the engine for interactive analysis.
+// Position changes arriving within the debounce window collapse into the
+// latest one, every search is tagged with its request id so output of
+// superseded searches is dropped, and each request runs a quick shallow
+// search before the full-depth one.
+class AnalysisScheduler {
+public:
+    struct Options {
+        int debounceMs = 40;
+        int quickDepth = 10;
+        int fullDepth = 20;
+        int multiPv = 3;        // lines searched per position
+    };
+
+    struct Metrics {
+        uint64_t submitted = 0;
+        uint64_t coalesced = 0;         // replaced before a search started
+        uint64_t searchesStarted = 0;
+        uint64_t cacheHits = 0;
+        uint64_t staleDiscarded = 0;    // output lines from superseded searches
+        uint64_t firstEvalCount = 0;
+        double firstEvalTotalMs = 0.0;
+        double lastFirstEvalMs = 0.0;
+        double meanFirstEvalMs() const { return firstEvalCount ? firstEvalTotalMs / firstEvalCount : 0.0; }
+    };
+
+    AnalysisScheduler(StockfishClient& engine);
+    AnalysisScheduler(StockfishClient& engine, Options options);
+    ~AnalysisScheduler();
+
+    void start();
+    void stop();
+
+    // Latest submission wins. Returns the request id.
+    uint64_t submit(const std::string& fen);
+    // Position inside a game; sent as "position fen <start> moves ..." so the
+    // engine reuses its hash between plies and sees repetitions
+    uint64_t submit(const std::string& startFen, const std::vector<std::string>& moves);
+    // Drops pending work and stops the running search
+    void cancel();
+    // Re-runs the active request, e.g. after the engine was restarted
+    void replay();
+
+    using UpdateCallback = std::function<void(const AnalysisUpdate& update)>;
+    void setUpdateCallback(UpdateCallback cb);
+
+    Metrics getMetrics() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        uint64_t id = 0;
+        std::string fen;                // position searched
+        std::string startFen;
+        std::vector<std::string> moves;
+        Clock::time_point submitted;
+        bool quickPhase = true;
+        bool firstEvalSeen = false;
+    };
+
+    StockfishClient& engine;
+    Options options;
+
+    std::thread worker;
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    bool running = false;
+
+    uint64_t nextId = 1;
+    bool hasPending = false;
+    Request pending;
+    Request active;
+    bool deepenRequested = false;
+
+    StockfishClient::CommandBatch commands; // Worker thread only; buffer reused
+    UpdateCallback onUpdate;
+    Metrics metrics;
+
+    void workerLoop();
+    void startRequest(std::unique_lock<std::mutex>& lock);
+    void deepen(std::unique_lock<std::mutex>& lock);
+    void onSearchOutput(uint64_t requestId, const EngineResult& info, bool final);
+    void recordFirstEval(Request& req);
+    SearchLimits limitsFor(int depth) const;
+};
+
+} // namespace Engine
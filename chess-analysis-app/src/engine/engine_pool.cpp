@@ -0,0 +1,104 @@
+#include "engine_pool.hpp"
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+namespace Engine {
+
+EnginePool::EnginePool(const std::string& path) : EnginePool(path, Options{}) {}
+
+EnginePool::EnginePool(const std::string& path, Options opts) : exePath(path), options(opts) {
+    int hw = (int)std::max(1u, std::thread::hardware_concurrency());
+    int threads = options.totalThreads > 0 ? options.totalThreads : hw;
+    int count = options.instances > 0 ? options.instances : threads;
+    // Each instance needs a useful hash table of its own
+    int maxByHash = std::max(1, options.totalHashMb / std::max(1, options.minHashMb));
+    instanceCount = std::clamp(count, 1, maxByHash);
+    threadsPerInstance = std::max(1, threads / instanceCount);
+    hashPerInstanceMb = std::max(1, options.totalHashMb / instanceCount);
+}
+
+EnginePool::~EnginePool() {
+    stop();
+}
+
+size_t EnginePool::start() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (!supervisors.empty()) return supervisors.size();
+
+    for (int i = 0; i < instanceCount; i++) {
+        auto client = std::make_unique<StockfishClient>(exePath);
+        // Stored before start, so they are also replayed after a restart
+        client->setOption("Threads", std::to_string(threadsPerInstance));
+        client->setOption("Hash", std::to_string(hashPerInstanceMb));
+        client->setCache(cache);
+        if (!client->start()) break;
+
+        auto supervisor = std::make_unique<EngineSupervisor>(*client);
+        supervisor->start();
+        clients.push_back(std::move(client));
+        supervisors.push_back(std::move(supervisor));
+    }
+    return supervisors.size();
+}
+
+void EnginePool::stop() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    for (auto& s : supervisors) s->stop();
+    for (auto& c : clients) c->stop();
+    supervisors.clear();
+    clients.clear();
+}
+
+size_t EnginePool::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return supervisors.size();
+}
+
+std::string EnginePool::engineName() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (clients.empty()) return "";
+    // "id name" comes before the answer to the first isready
+    clients[0]->ping(NAME_TIMEOUT_MS);
+    return clients[0]->getEngineName();
+}
+
+void EnginePool::setCache(AnalysisCache* c) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    cache = c;
+    for (auto& client : clients) client->setCache(c);
+}
+
+void EnginePool::forEach(size_t count, const std::function<void(EngineSupervisor& engine, size_t index)>& fn) {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    size_t workers = std::min(supervisors.size(), count);
+    if (workers == 0) return;
+
+    std::atomic<size_t> next{0};
+    auto run = [&](EngineSupervisor& engine) {
+        for (size_t i = next++; i < count; i = next++) {
+            fn(engine, i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t w = 1; w < workers; w++) {
+        threads.emplace_back(run, std::ref(*supervisors[w]));
+    }
+    run(*supervisors[0]);
+    for (auto& t : threads) t.join();
+}
+
+bool EnginePool::withEngine(size_t index, const std::function<void(EngineSupervisor& engine)>& fn) {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (index >= supervisors.size()) return false;
+    fn(*supervisors[index]);
+    return true;
+}
+
+void EnginePool::interrupt() {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    for (auto& client : clients) client->stopAnalysis();
+}
+
+} // namespace Engine
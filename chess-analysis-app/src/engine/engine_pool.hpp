@@ -0,0 +1,69 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <shared_mutex>
+#include "stockfish.hpp"
+#include "engine_supervisor.hpp"
+
+namespace Engine {
+
+// Several supervised engine processes for throughput work such as game
+// review. Independent single-position searches scale far better across
+// processes than one search does across threads, so the machine's threads
+// and the hash budget are divided between the instances.
+class EnginePool {
+public:
+    struct Options {
+        int instances = 0;      // 0: one per hardware thread
+        int totalThreads = 0;   // 0: hardware concurrency
+        int totalHashMb = 512;
+        int minHashMb = 16;     // per instance; caps the instance count
+    };
+
+    EnginePool(const std::string& path);
+    EnginePool(const std::string& path, Options options);
+    ~EnginePool();
+
+    // Starts the engines if not already running. Returns how many are up.
+    size_t start();
+    void stop();
+    size_t size() const;
+
+    // Shared by every instance; must outlive the pool's engines
+    void setCache(AnalysisCache* cache);
+
+    // Calls fn(engine, i) for every i in [0, count), spread over the
+    // engines. Blocks until all items are done. Items are claimed in
+    // index order, so early plies finish first.
+    void forEach(size_t count, const std::function<void(EngineSupervisor& engine, size_t index)>& fn);
+    // Stops the searches in flight; safe to call while forEach runs
+    void interrupt();
+    // Runs fn on engine `index` under the pool's shared lock. False if the
+    // pool has no such engine. Callers keep one thread per index.
+    bool withEngine(size_t index, const std::function<void(EngineSupervisor& engine)>& fn);
+
+    // Name reported by the engines, once their handshake is done (waits up
+    // to NAME_TIMEOUT_MS for it); empty when none is running
+    std::string engineName() const;
+    static constexpr int NAME_TIMEOUT_MS = 5000;
+
+    int threadsPerEngine() const { return threadsPerInstance; }
+    int hashPerEngineMb() const { return hashPerInstanceMb; }
+
+private:
+    std::string exePath;
+    Options options;
+    int instanceCount = 1;
+    int threadsPerInstance = 1;
+    int hashPerInstanceMb = 16;
+    AnalysisCache* cache = nullptr;
+
+    // Unique for start/stop; shared for forEach and interrupt
+    mutable std::shared_mutex mutex;
+    std::vector<std::unique_ptr<StockfishClient>> clients;
+    std::vector<std::unique_ptr<EngineSupervisor>> supervisors;
+};
+
+} // namespace Engine
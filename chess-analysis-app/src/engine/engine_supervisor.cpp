@@ -0,0 +1,122 @@
+#include "engine_supervisor.hpp"
+#include <chrono>
+#include <algorithm>
+
+namespace Engine {
+
+EngineSupervisor::EngineSupervisor(StockfishClient& eng) : EngineSupervisor(eng, Options{}) {}
+
+EngineSupervisor::EngineSupervisor(StockfishClient& eng, Options opts) : engine(eng), options(opts) {}
+
+EngineSupervisor::~EngineSupervisor() {
+    stop();
+}
+
+void EngineSupervisor::start() {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    if (running) return;
+    running = true;
+    healthThread = std::thread(&EngineSupervisor::healthLoop, this);
+}
+
+void EngineSupervisor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (!running) return;
+        running = false;
+    }
+    stateCv.notify_all();
+    if (healthThread.joinable()) healthThread.join();
+}
+
+void EngineSupervisor::setRestartCallback(RestartCallback cb) {
+    std::lock_guard<std::mutex> lock(countersMutex);
+    onRestart = cb;
+}
+
+EngineSupervisor::Counters EngineSupervisor::getCounters() const {
+    std::lock_guard<std::mutex> lock(countersMutex);
+    return counters;
+}
+
+bool EngineSupervisor::restart() {
+    bool ok;
+    {
+        std::lock_guard<std::mutex> lock(restartMutex);
+        engine.stop();
+        ok = engine.start();
+    }
+
+    RestartCallback cb;
+    {
+        std::lock_guard<std::mutex> lock(countersMutex);
+        if (ok) counters.restarts++;
+        else counters.failedRestarts++;
+        cb = onRestart;
+    }
+    if (ok && cb) cb();
+    return ok;
+}
+
+void EngineSupervisor::healthLoop() {
+    int backoff = 1;
+    std::unique_lock<std::mutex> lock(stateMutex);
+    while (running) {
+        stateCv.wait_for(lock, std::chrono::milliseconds(options.pingIntervalMs * backoff));
+        if (!running) break;
+        lock.unlock();
+
+        bool healthy = engine.ping(options.pingTimeoutMs);
+        if (!healthy) {
+            {
+                std::lock_guard<std::mutex> countersLock(countersMutex);
+                counters.pingFailures++;
+            }
+            // Back off while the engine keeps failing to come up
+            backoff = restart() ? 1 : std::min(backoff * 2, 16);
+        } else {
+            backoff = 1;
+        }
+        lock.lock();
+    }
+}
+
+bool EngineSupervisor::analyze(const std::string& fen, int depth, EngineResult& out) {
+    return analyze(fen, {}, depth, out);
+}
+
+bool EngineSupervisor::analyze(const std::string& startFen, const std::vector<std::string>& moves, int depth, EngineResult& out) {
+    return analyze(startFen, moves, SearchLimits::ofDepth(depth), out);
+}
+
+bool EngineSupervisor::analyze(const std::string& startFen, const std::vector<std::string>& moves, const SearchLimits& limits, EngineResult& out) {
+    auto t0 = std::chrono::steady_clock::now();
+    for (int attempt = 0; attempt <= options.maxRetries; attempt++) {
+        uint64_t restartsBefore = getCounters().restarts;
+        auto status = engine.tryAnalyzePosition(startFen, moves, limits, options.requestTimeoutMs, out);
+        if (status != StockfishClient::SearchStatus::Failed) {
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            std::lock_guard<std::mutex> lock(countersMutex);
+            counters.requests++;
+            counters.totalLatencyMs += ms;
+            if (status == StockfishClient::SearchStatus::TimedOut) counters.timeouts++;
+            return true;
+        }
+
+        // Lost the request: bring the engine back and replay it, unless the
+        // health thread already restarted it underneath us
+        bool restartedMeanwhile;
+        {
+            std::lock_guard<std::mutex> lock(countersMutex);
+            counters.failedSearches++;
+            restartedMeanwhile = counters.restarts != restartsBefore;
+        }
+        if (!restartedMeanwhile && !restart()) break;
+    }
+
+    std::lock_guard<std::mutex> lock(countersMutex);
+    counters.failures++;
+    return false;
+}
+
+} // namespace Engine
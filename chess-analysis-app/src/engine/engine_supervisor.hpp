@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+#include "stockfish.hpp"
+
+namespace Engine {
+
+// Keeps a StockfishClient usable for long-running sessions: pings it with
+// isready, restarts it (options are replayed by the client) when it crashes
+// or stops answering, and retries blocking requests that were lost.
+class EngineSupervisor {
+public:
+    struct Options {
+        int pingIntervalMs = 2000;
+        int pingTimeoutMs = 3000;
+        int requestTimeoutMs = 60000;   // watchdog per blocking request
+        int maxRetries = 1;             // replays after a restart
+    };
+
+    struct Counters {
+        uint64_t restarts = 0;
+        uint64_t failedRestarts = 0;
+        uint64_t pingFailures = 0;
+        uint64_t timeouts = 0;
+        uint64_t failedSearches = 0;    // engine crashed or the pipe broke
+        uint64_t requests = 0;
+        uint64_t failures = 0;          // gave up after all retries
+        double totalLatencyMs = 0.0;
+        double meanLatencyMs() const { return requests ? totalLatencyMs / requests : 0.0; }
+    };
+
+    EngineSupervisor(StockfishClient& engine);
+    EngineSupervisor(StockfishClient& engine, Options options);
+    ~EngineSupervisor();
+
+    // Starts the health-check thread; the engine must already be started
+    void start();
+    void stop();
+
+    // Blocking analysis with watchdog and replay. Returns false only if
+    // the engine could not produce a result after all retries.
+    bool analyze(const std::string& startFen, const std::vector<std::string>& moves, int depth, EngineResult& out);
+    bool analyze(const std::string& fen, int depth, EngineResult& out);
+    bool analyze(const std::string& startFen, const std::vector<std::string>& moves, const SearchLimits& limits, EngineResult& out);
+
+    // Called after a successful restart, e.g. to replay interactive analysis
+    using RestartCallback = std::function<void()>;
+    void setRestartCallback(RestartCallback cb);
+
+    bool restart();
+    Counters getCounters() const;
+    StockfishClient& client() { return engine; }
+
+private:
+    StockfishClient& engine;
+    Options options;
+
+    std::thread healthThread;
+    std::mutex stateMutex;
+    std::condition_variable stateCv;
+    bool running = false;
+
+    std::mutex restartMutex;  // One restart at a time
+    mutable std::mutex countersMutex;
+    Counters counters;
+    RestartCallback onRestart;
+
+    void healthLoop();
+};
+
+} // namespace Engine
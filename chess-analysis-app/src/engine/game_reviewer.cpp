@@ -1,65 +1,555 @@
 #include "game_reviewer.hpp"
 #include <cmath>
+#include <cctype>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdio>
 
 namespace Chess {
 
-void GameReviewer::startReview(const std::vector<std::string>& fens, Engine::StockfishClient& engine, int depth, const std::string& game_result) {
+namespace {
+
+// Floor of a budgeted search, so a tight budget still gives usable evals
+constexpr uint64_t MIN_BUDGET_NODES = 5000;
+constexpr int MIN_BUDGET_MS = 10;
+
+// Searched, or with nothing to search: the engine answers a mated or
+// stalemated position at depth 0
+bool settled(const std::string& fen, const Engine::EngineResult& eval) {
+    return eval.depth > 0 || Board(fen).getLegalMoves().empty();
+}
+
+// Whether a review may be saved or shown from these evals
+bool allSettled(const std::vector<std::string>& fens, const std::vector<Engine::EngineResult>& evals) {
+    if (evals.size() != fens.size()) return false;
+    for (size_t i = 0; i < fens.size(); ++i) {
+        if (!settled(fens[i], evals[i])) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+GameReviewer::GameReviewer()
+    : results_(std::make_shared<const std::vector<MoveReview>>()), report_(std::make_shared<const ReviewReport>()) {}
+
+GameReviewer::~GameReviewer() {
+    cancel();
+}
+
+void GameReviewer::startReview(const std::vector<std::string>& fens, const std::vector<std::string>& uci_moves, Engine::EnginePool& engines,
+                               const ReviewSettings& settings, const std::string& game_result) {
+    cancel();
+    cancel_ = false;
     complete_ = false;
-    results_.clear();
+    failed_ = false;
+    progress_ = 0.0f;
     if (fens.size() < 2) {
+        publish(std::make_shared<const std::vector<MoveReview>>(), std::make_shared<const ReviewReport>());
         progress_ = 1.0f;
         complete_ = true;
         return;
     }
-    
-    results_.resize(fens.size() - 1);
-    progress_ = 0.0f;
 
-    std::thread([this, fens, &engine, depth, game_result]() {
-        std::vector<float> evals(fens.size());
-        std::vector<std::string> best_moves(fens.size());
+    // Every ply starts out pending
+    std::vector<MoveReview> placeholders(fens.size() - 1);
+    for (size_t i = 0; i < placeholders.size(); ++i) {
+        placeholders[i] = {(int)i, 0.0f, 0.0f, 0.0f, "", MoveClassification::Good, false};
+    }
+    publish(std::make_shared<const std::vector<MoveReview>>(std::move(placeholders)),
+            std::make_shared<const ReviewReport>(fens.size() - 1));
 
-        // Phase 1: get eval for every position
-        for (size_t i = 0; i < fens.size(); ++i) {
-            auto res = engine.analyzePosition(fens[i], depth);
-            bool black_to_move = fens[i].find(" b ") != std::string::npos;
-            evals[i] = black_to_move ? -res.centipawns : res.centipawns;
-            best_moves[i] = res.best_move;
-            progress_ = (float)i / fens.size() * 0.9f;
+    engines_ = &engines;
+    running_ = true;
+    worker_ = std::thread([this, fens, uci_moves, &engines, settings, game_result]() {
+        // Spawning the engines and their handshake take a while: done here,
+        // off the caller's (GUI) thread. With none up every search fails.
+        engines.start();
+        if (cancel_) {
+            running_ = false;
+            return;
         }
 
-        // Phase 2: classify each move
-        for (size_t i = 0; i < results_.size(); ++i) {
-            bool white_to_move = (fens[i].find(" w ") != std::string::npos);
-            float before_white = evals[i];
-            float after_white  = evals[i + 1];
+        // Positions a stored review of this game searched with the same
+        // engine are not searched again, as far as these settings allow
+        bool keyed = store_ && uci_moves.size() + 1 == fens.size();
+        uint64_t key = keyed ? gameKey(fens[0], uci_moves) : 0;
+        std::string engine_name = engines.engineName();
+        std::vector<Engine::EngineResult> known;
+        StoredReview stored;
+        if (keyed && !engine_name.empty() && store_->load(key, stored) && stored.engine == engine_name &&
+            stored.evals.size() == fens.size()) {
+            known = reusableEvals(stored, settings);
+        }
 
-            float before_mover = white_to_move ? before_white : -before_white;
-            float after_mover  = white_to_move ? after_white  : -after_white;
+        // Positions searched so far; guarded by results_mutex_ together with
+        // the evals the runner writes, so plies are published as soon as
+        // both of their positions are known
+        std::vector<bool> have(fens.size(), false);
+        std::vector<MoveReview> live = *snapshot().results;
+        ReviewReport live_report(live.size());
+        if (known.size() == fens.size()) {
+            for (size_t i = 0; i < fens.size(); ++i) have[i] = known[i].depth > 0;
+            for (size_t ply = 0; ply + 1 < fens.size(); ++ply) {
+                if (have[ply] && have[ply + 1]) {
+                    live[ply] = classifyPly(fens, known, ply, game_result);
+                    live_report.set(live[ply]);
+                }
+            }
+            publish(std::make_shared<const std::vector<MoveReview>>(live), std::make_shared<const ReviewReport>(live_report));
+        }
 
-            float cp_loss = white_to_move ? (before_white - after_white) : (after_white - before_white);
-            cp_loss = std::max(0.0f, cp_loss);
+        // Phase 1: get eval for every position, plies spread over the pool.
+        // Each index is written by exactly one worker.
+        auto run = [&](const std::vector<size_t>& indices, const Engine::SearchLimits& limits,
+                       std::vector<Engine::EngineResult>& evals, const std::function<void(bool)>& done) {
+            std::vector<char> reported(indices.size(), 0);
+            engines.forEach(indices.size(), [&](Engine::EngineSupervisor& engine, size_t k) {
+                if (cancel_) return;
+                // Supervised: a hung or crashed engine is restarted and the
+                // position retried instead of stalling the review. With the
+                // moves known, every ply is sent as the start position plus
+                // the moves played, so an engine keeps its hash between plies.
+                size_t i = indices[k];
+                Engine::EngineResult res;
+                bool ok;
+                if (uci_moves.size() + 1 >= fens.size()) {
+                    std::vector<std::string> played(uci_moves.begin(), uci_moves.begin() + i);
+                    ok = engine.analyze(fens[0], played, limits, res);
+                } else {
+                    ok = engine.analyze(fens[i], {}, limits, res);
+                }
+                if (cancel_) return;
+                reported[k] = 1;
+                // The engine died and could not be brought back
+                if (!ok) {
+                    done(false);
+                    return;
+                }
 
-            auto classification = classifyMove(cp_loss, before_mover);
-            if (i == results_.size() - 1) {
-                if ((white_to_move && game_result == "1-0") || (!white_to_move && game_result == "0-1")) {
-                    classification = MoveClassification::GameEnd;
+                std::shared_ptr<const std::vector<MoveReview>> update;
+                std::shared_ptr<const ReviewReport> report;
+                {
+                    std::lock_guard<std::mutex> lock(results_mutex_);
+                    evals[i] = res;
+                    have[i] = true;
+                    // Plies i-1 and i may now have both of their positions
+                    for (size_t ply = (i > 0 ? i - 1 : 0); ply <= i && ply + 1 < fens.size(); ++ply) {
+                        if (have[ply] && have[ply + 1]) {
+                            live[ply] = classifyPly(fens, evals, ply, game_result);
+                            live_report.set(live[ply]);
+                        }
+                    }
+                    update = std::make_shared<const std::vector<MoveReview>>(live);
+                    report = std::make_shared<const ReviewReport>(live_report);
                 }
+                publish(update, report);
+                done(true);
+            });
+            // Positions no engine took, e.g. when none could be started
+            for (size_t k = 0; k < indices.size() && !cancel_; ++k) {
+                if (!reported[k]) done(false);
             }
-
-            results_[i] = {
-                (int)i,
-                before_white,
-                after_white,
-                cp_loss,
-                best_moves[i],
-                classification
-            };
+        };
+        ReviewStats stats;
+        auto evals = evaluatePositions(fens, uci_moves, settings, run, &stats, [this](float p) { progress_ = p * 0.9f; }, known);
+        if (cancel_) {
+            running_ = false;
+            return;
+        }
+        // Unsearched positions would read as a flawless game: keep the
+        // plies published so far, but neither finish nor save the review
+        if (stats.failed > 0) {
+            failed_ = true;
+            running_ = false;
+            return;
         }
+        // Only fully searched reviews are saved, under a known engine
+        if (keyed && stats.stored < stats.positions && !engine_name.empty() && allSettled(fens, evals)) {
+            store_->save(key, {engine_name, settings.depth, settingsFingerprint(settings), evals});
+        }
+
+        // Phase 2: classify each move
+        auto reviews = classifyGame(fens, evals, game_result);
+        auto report = std::make_shared<const ReviewReport>(ReviewReport::fromReviews(reviews));
+        publish(std::make_shared<const std::vector<MoveReview>>(std::move(reviews)), report);
         progress_ = 1.0f;
         complete_ = true;
-    }).detach();
+        running_ = false;
+    });
+}
+
+std::string settingsFingerprint(const ReviewSettings& s) {
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), "depth=%d adaptive=%d shallow=%d margin=%g swing=%g gap=%g nodes=%llu movetime=%d "
+                  "node_budget=%llu time_budget=%d shallow_share=%g multipv=%d single_session=%d reuse=%d",
+                  s.depth, s.adaptive ? 1 : 0, s.shallow_depth, s.threshold_margin, s.swing_cp, s.multipv_gap_cp,
+                  (unsigned long long)s.nodes, s.movetime_ms, (unsigned long long)s.node_budget, s.time_budget_ms,
+                  s.shallow_share, s.multipv, s.single_session ? 1 : 0, s.reuse_best_move ? 1 : 0);
+    return buf;
+}
+
+std::vector<Engine::EngineResult> reusableEvals(const StoredReview& stored, const ReviewSettings& settings) {
+    std::vector<Engine::EngineResult> evals = stored.evals;
+    if (stored.settings == settingsFingerprint(settings)) return evals;
+    bool depthLimited = settings.nodes == 0 && settings.movetime_ms <= 0 &&
+                        settings.node_budget == 0 && settings.time_budget_ms <= 0;
+    for (auto& eval : evals) {
+        if (!depthLimited || eval.depth < settings.depth) eval.depth = 0;
+    }
+    return evals;
+}
+
+void GameReviewer::setStore(ReviewStore* store) {
+    cancel();
+    store_ = store;
+}
+
+bool GameReviewer::restoreReview(const std::vector<std::string>& fens, const std::vector<std::string>& uci_moves, const std::string& game_result) {
+    cancel();
+    StoredReview stored;
+    if (!store_ || fens.size() < 2 || uci_moves.size() + 1 != fens.size()) return false;
+    if (!store_->load(gameKey(fens[0], uci_moves), stored) || stored.evals.size() != fens.size()) return false;
+    // Records with unsearched positions or no engine name are not shown
+    if (stored.engine.empty() || !allSettled(fens, stored.evals)) return false;
+
+    auto reviews = classifyGame(fens, stored.evals, game_result);
+    auto report = std::make_shared<const ReviewReport>(ReviewReport::fromReviews(reviews));
+    publish(std::make_shared<const std::vector<MoveReview>>(std::move(reviews)), report);
+    progress_ = 1.0f;
+    complete_ = true;
+    failed_ = false;
+    return true;
+}
+
+void GameReviewer::cancel() {
+    if (!worker_.joinable()) return;
+    cancel_ = true;
+    // Searches in flight end early with "stop"
+    if (engines_) engines_->interrupt();
+    worker_.join();
+    running_ = false;
+}
+
+void GameReviewer::publish(std::shared_ptr<const std::vector<MoveReview>> results, std::shared_ptr<const ReviewReport> report) {
+    std::lock_guard<std::mutex> lock(results_mutex_);
+    results_ = std::move(results);
+    report_ = std::move(report);
+}
+
+ReviewSnapshot GameReviewer::snapshot() const {
+    ReviewSnapshot snap;
+    {
+        std::lock_guard<std::mutex> lock(results_mutex_);
+        snap.results = results_;
+        snap.report = report_;
+    }
+    snap.progress = progress_;
+    snap.complete = complete_;
+    snap.running = running_;
+    snap.failed = failed_;
+    return snap;
+}
+
+std::vector<MoveReview> GameReviewer::getResults() const {
+    std::lock_guard<std::mutex> lock(results_mutex_);
+    return *results_;
+}
+
+bool GameReviewer::isRunning() const {
+    return running_;
+}
+
+Engine::SearchLimits GameReviewer::fullLimits(const ReviewSettings& settings) const {
+    Engine::SearchLimits limits;
+    limits.depth = settings.depth;
+    limits.nodes = settings.nodes;
+    limits.movetimeMs = settings.movetime_ms;
+    limits.multiPv = settings.multipv;
+    // Budgeted searches stop on nodes or time only
+    if (settings.node_budget > 0 || settings.time_budget_ms > 0) limits.depth = 0;
+    return limits;
+}
+
+bool GameReviewer::nearBoundary(float win_loss, float margin) const {
+    // Same boundaries as classifyWinLoss
+    for (float boundary : {1.0f, 2.5f, 5.0f, 10.0f, 20.0f}) {
+        if (std::fabs(win_loss - boundary) <= std::max(0.5f, boundary * margin)) return true;
+    }
+    return false;
+}
+
+std::vector<Engine::EngineResult> GameReviewer::evaluatePositions(const std::vector<std::string>& fens, const std::vector<std::string>& moves,
+                                                                 const ReviewSettings& settings, const SearchRunner& run, ReviewStats* stats,
+                                                                 const std::function<void(float)>& progress,
+                                                                 const std::vector<Engine::EngineResult>& known) {
+    size_t n = fens.size();
+    std::vector<Engine::EngineResult> evals(n);
+    ReviewStats local;
+    ReviewStats& st = stats ? *stats : local;
+    st = ReviewStats{};
+    st.positions = (int)n;
+
+    // A position with one legal move needs no search: its eval is the next one's
+    std::vector<std::string> forced(n);
+    std::vector<bool> stored(n, false);
+    std::vector<size_t> todo;
+    for (size_t i = 0; i < n; ++i) {
+        if (known.size() == n && known[i].depth > 0) {
+            evals[i] = known[i];
+            stored[i] = true;
+            st.stored++;
+            continue;
+        }
+        if (settings.adaptive && i + 1 < n) {
+            Board board(fens[i]);
+            auto legal = board.getLegalMoves();
+            if (legal.size() == 1) {
+                forced[i] = legal[0].toString();
+                st.forced_skipped++;
+                continue;
+            }
+        }
+        todo.push_back(i);
+    }
+    auto fill_forced = [&]() {
+        for (size_t i = n - 1; i-- > 0;) {
+            if (forced[i].empty()) continue;
+            const auto& next = evals[i + 1];
+            Engine::EngineResult r;
+            r.centipawns = -next.centipawns;
+            r.score = -next.score;  // mate distance may be off by one
+            r.is_mate = next.is_mate;
+            r.depth = next.depth;
+            r.best_move = forced[i];
+            r.pv = {forced[i]};
+            evals[i] = r;
+        }
+    };
+
+    // Progress is per finished search over both passes
+    size_t planned = todo.size() * (settings.adaptive ? 2 : 1);
+    size_t finished = 0;
+    std::mutex progress_mutex;
+    auto on_done = [&](bool ok) {
+        std::lock_guard<std::mutex> lock(progress_mutex);
+        if (!ok) st.failed++;
+        finished++;
+        if (progress) progress(planned ? std::min(1.0f, (float)finished / planned) : 1.0f);
+    };
+    bool walk = settings.single_session && moves.size() + 1 >= n;
+
+    // Returns the number of searches actually run
+    // With a budget, each pass gets `share` of what is left and spreads it
+    // evenly over its searches; a walk re-spreads after every search, so
+    // positions taken from the PV leave their part to the ones after
+    bool budgeted = settings.node_budget > 0 || settings.time_budget_ms > 0;
+    auto started = std::chrono::steady_clock::now();
+    auto elapsed_ms = [&](std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    };
+
+    auto search = [&](const std::vector<size_t>& indices, const Engine::SearchLimits& base, float share) {
+        uint64_t pass_nodes = 0;
+        double pass_ms = 0.0;
+        if (settings.node_budget > 0) pass_nodes = (uint64_t)((settings.node_budget > st.nodes ? settings.node_budget - st.nodes : 0) * share);
+        if (settings.time_budget_ms > 0) pass_ms = std::max(0.0, settings.time_budget_ms - elapsed_ms(started)) * share;
+        uint64_t nodes_before = st.nodes;
+        auto pass_start = std::chrono::steady_clock::now();
+        auto limits_for = [&](size_t left) {
+            Engine::SearchLimits limits = base;
+            if (!budgeted || left == 0) return limits;
+            if (settings.node_budget > 0) {
+                uint64_t used = st.nodes - nodes_before;
+                limits.nodes = std::max<uint64_t>(MIN_BUDGET_NODES, (pass_nodes > used ? pass_nodes - used : 0) / left);
+            }
+            if (settings.time_budget_ms > 0) {
+                limits.movetimeMs = std::max(MIN_BUDGET_MS, (int)(std::max(0.0, pass_ms - elapsed_ms(pass_start)) / left));
+            }
+            return limits;
+        };
+
+        if (!walk) {
+            run(indices, limits_for(indices.size()), evals, on_done);
+            for (size_t i : indices) st.nodes += evals[i].nodes;
+            return (int)indices.size();
+        }
+
+        // One position at a time, in game order, so the engine's hash carries
+        // over. When the player found the engine's move, the position after
+        // it is the PV continuation: its eval and best reply are taken from
+        // the search before instead of searching again. The PV has no
+        // alternatives, so if the reply played is the PV's too, the position
+        // is searched after all: only its MultiPV lines tell an only move.
+        int searched = 0;
+        std::vector<bool> from_search(n, false);
+        for (size_t k = 0; k < indices.size(); ++k) {
+            size_t i = indices[k];
+            const auto& prev = i > 0 ? evals[i - 1] : evals[0];
+            if (settings.reuse_best_move && i > 0 && from_search[i - 1] &&
+                prev.pv.size() >= 2 && moves[i - 1] == prev.best_move &&
+                !(i < moves.size() && moves[i] == prev.pv[1])) {
+                Engine::EngineResult r;
+                r.centipawns = -prev.centipawns;
+                r.score = -prev.score;
+                r.is_mate = prev.is_mate;
+                r.depth = prev.depth - 1;
+                r.wdl[0] = prev.wdl[2];
+                r.wdl[1] = prev.wdl[1];
+                r.wdl[2] = prev.wdl[0];
+                r.pv.assign(prev.pv.begin() + 1, prev.pv.end());
+                r.best_move = r.pv[0];
+                evals[i] = r;
+                st.reused++;
+                on_done(true);
+                continue;
+            }
+            run({i}, limits_for(indices.size() - k), evals, on_done);
+            if (st.failed > 0) break;
+            st.nodes += evals[i].nodes;
+            from_search[i] = true;
+            searched++;
+        }
+        return searched;
+    };
+
+    if (!settings.adaptive) {
+        st.deep_searches = search(todo, fullLimits(settings), 1.0f);
+        fill_forced();
+        return evals;
+    }
+
+    Engine::SearchLimits shallow = Engine::SearchLimits::ofDepth(settings.shallow_depth);
+    shallow.multiPv = std::max(2, settings.multipv);
+    st.shallow_searches = search(todo, shallow, settings.shallow_share);
+    fill_forced();
+    if (st.failed > 0) return evals;
+
+    // Deepen where the shallow verdict is fragile: a loss near a class
+    // boundary, a large eval swing, or a close second-best move
+    auto reviews = classifyGame(fens, evals);
+    std::vector<bool> deepen(n, false);
+    for (size_t i = 0; i < reviews.size(); ++i) {
+        if (!forced[i].empty()) continue;
+        const auto& r = reviews[i];
+        bool fragile = nearBoundary(r.win_loss, settings.threshold_margin) ||
+                       std::fabs(r.eval_after - r.eval_before) > settings.swing_cp;
+        const auto& lines = evals[i].lines;
+        bool close_second = lines.size() >= 2 && !lines[1].move.empty() &&
+                            std::fabs(lines[0].centipawns - lines[1].centipawns) < settings.multipv_gap_cp;
+        if (fragile) {
+            deepen[i] = true;
+            deepen[i + 1] = true;
+        }
+        if (close_second) deepen[i] = true;
+    }
+
+    std::vector<size_t> deep;
+    for (size_t i = 0; i < n; ++i) {
+        if (deepen[i] && forced[i].empty() && !stored[i]) deep.push_back(i);
+    }
+    planned = todo.size() + deep.size();
+    Engine::SearchLimits full = fullLimits(settings);
+    st.deep_searches = search(deep, full, 1.0f);
+    fill_forced();
+    if (progress) progress(1.0f);
+    return evals;
+}
+
+std::vector<MoveReview> GameReviewer::classifyGame(const std::vector<std::string>& fens, const std::vector<Engine::EngineResult>& evals, const std::string& game_result) {
+    std::vector<MoveReview> reviews;
+    if (fens.size() < 2 || evals.size() != fens.size()) return reviews;
+    reviews.resize(fens.size() - 1);
+    for (size_t i = 0; i < reviews.size(); ++i) {
+        reviews[i] = classifyPly(fens, evals, i, game_result);
+    }
+    return reviews;
+}
+
+MoveReview GameReviewer::classifyPly(const std::vector<std::string>& fens, const std::vector<Engine::EngineResult>& evals, size_t i, const std::string& game_result) {
+    // Engine scores are from the side to move; reviews use White's view
+    auto white_eval = [&](size_t j) {
+        bool black_to_move = fens[j].find(" b ") != std::string::npos;
+        return black_to_move ? -evals[j].centipawns : evals[j].centipawns;
+    };
+
+    bool white_to_move = (fens[i].find(" w ") != std::string::npos);
+    float before_white = white_eval(i);
+    float after_white  = white_eval(i + 1);
+
+    float cp_loss = white_to_move ? (before_white - after_white) : (after_white - before_white);
+    cp_loss = std::max(0.0f, cp_loss);
+
+    // Expected scores of the mover, each at its own position's material
+    const auto& before = evals[i];
+    const auto& after = evals[i + 1];
+    int material_before = materialCount(fens[i]);
+    float score_before = expectedScore(before.centipawns, before.is_mate, material_before);
+    float score_after = 100.0f - expectedScore(after.centipawns, after.is_mate, materialCount(fens[i + 1]));
+    float win_loss = std::max(0.0f, score_before - score_after);
+
+    auto classification = classifyWinLoss(win_loss);
+    if (classification == MoveClassification::Best) {
+        // The MultiPV alternatives come from the same search: when the second
+        // best line loses a lot, the move played was the only one
+        const auto& lines = before.lines;
+        bool only_move = lines.size() >= 2 && !lines[1].move.empty() &&
+                         score_before - expectedScore(lines[1].centipawns, lines[1].is_mate, material_before) >= 15.0f;
+        if (isSacrifice(fens[i], fens[i + 1], after.best_move) && score_after >= 50.0f && score_before < 95.0f) {
+            classification = MoveClassification::Brilliant;
+        } else if (only_move) {
+            classification = MoveClassification::Great;
+        }
+    }
+    if (i == fens.size() - 2) {
+        if ((white_to_move && game_result == "1-0") || (!white_to_move && game_result == "0-1")) {
+            classification = MoveClassification::GameEnd;
+        }
+    }
+
+    MoveReview review = {
+        (int)i,
+        before_white,
+        after_white,
+        cp_loss,
+        before.best_move,
+        classification
+    };
+    review.win_loss = win_loss;
+    review.win_after = white_to_move ? score_after : 100.0f - score_after;
+    review.phase = gamePhase(fens[i]);
+    return review;
+}
+
+bool GameReviewer::isSacrifice(const std::string& fen_before, const std::string& fen_after, const std::string& reply) const {
+    if (reply.empty()) return false;
+    // Material of the mover minus the opponent's, in pawns
+    auto balance = [](const std::string& fen, bool white) {
+        int diff = 0;
+        for (char c : fen.substr(0, fen.find(' '))) {
+            int value = 0;
+            switch (std::tolower(c)) {
+                case 'p': value = 1; break;
+                case 'n': case 'b': value = 3; break;
+                case 'r': value = 5; break;
+                case 'q': value = 9; break;
+            }
+            diff += (std::isupper(c) != 0) == white ? value : -value;
+        }
+        return diff;
+    };
+    bool white = fen_before.find(" w ") != std::string::npos;
+
+    // Gives up at least a minor piece (or the exchange) after the best reply
+    Board board(fen_after);
+    for (const auto& m : board.getLegalMoves()) {
+        if (m.toString() != reply) continue;
+        board.makeMove(m);
+        return balance(board.getFen(), white) <= balance(fen_before, white) - 2;
+    }
+    return false;
 }
 
 bool GameReviewer::isReviewComplete() const {
@@ -83,32 +573,164 @@ MoveClassification GameReviewer::classifyMove(float cp_loss, float eval_before)
     return MoveClassification::Blunder;
 }
 
+const char* classificationName(MoveClassification c) {
+    switch (c) {
+        case MoveClassification::Brilliant:  return "Brilliant";
+        case MoveClassification::Great:      return "Great";
+        case MoveClassification::Best:       return "Best";
+        case MoveClassification::Excellent:  return "Excellent";
+        case MoveClassification::Good:       return "Good";
+        case MoveClassification::Inaccuracy: return "Inaccuracy";
+        case MoveClassification::Mistake:    return "Mistake";
+        case MoveClassification::Blunder:    return "Blunder";
+        case MoveClassification::Book:       return "Book";
+        case MoveClassification::GameEnd:    return "GameEnd";
+    }
+    return "";
+}
+
+int materialCount(const std::string& fen) {
+    int material = 0;
+    for (char c : fen.substr(0, fen.find(' '))) {
+        switch (std::tolower(c)) {
+            case 'p': material += 1; break;
+            case 'n': case 'b': material += 3; break;
+            case 'r': material += 5; break;
+            case 'q': material += 9; break;
+        }
+    }
+    return material;
+}
+
+float winRate(float centipawns, int material) {
+    // Coefficients from Stockfish's win_rate_model (uci.cpp)
+    double m = std::clamp(material, 17, 78) / 58.0;
+    double a = ((-72.32565836 * m + 185.93832038) * m - 144.58862193) * m + 416.44950446;
+    double b = ((83.86794042 * m - 136.06112997) * m + 69.98820887) * m + 47.62901433;
+    // UCI scores are normalized by a; back to the engine's internal units
+    double v = centipawns * a / 100.0;
+    return (float)(1000.0 / (1.0 + std::exp((a - v) / b)));
+}
+
+float expectedScore(float centipawns, bool is_mate, int material) {
+    if (is_mate) return centipawns > 0 ? 100.0f : 0.0f;
+    float win = winRate(centipawns, material);
+    float loss = winRate(-centipawns, material);
+    return (win + (1000.0f - win - loss) / 2.0f) / 10.0f;
+}
+
+MoveClassification classifyWinLoss(float win_loss) {
+    if (win_loss < 1.0f)  return MoveClassification::Best;
+    if (win_loss < 2.5f)  return MoveClassification::Excellent;
+    if (win_loss < 5.0f)  return MoveClassification::Good;
+    if (win_loss < 10.0f) return MoveClassification::Inaccuracy;
+    if (win_loss < 20.0f) return MoveClassification::Mistake;
+    return MoveClassification::Blunder;
+}
+
 ReviewSummary computeSummary(const std::vector<MoveReview>& reviews, bool white) {
-    ReviewSummary s = {};
-    float total_cp_loss = 0;
-    int move_count = 0;
+    return ReviewReport::fromReviews(reviews).side(white).summary();
+}
 
-    for (size_t i = 0; i < reviews.size(); ++i) {
-        bool is_white_move = (i % 2 == 0);
-        if (is_white_move != white) continue;
-        
-        if (reviews[i].classification == MoveClassification::GameEnd) continue;
-
-        move_count++;
-        total_cp_loss += reviews[i].cp_loss;
-        
-        switch(reviews[i].classification) {
-            case MoveClassification::Blunder:    s.blunders++;    break;
-            case MoveClassification::Mistake:    s.mistakes++;    break;
-            case MoveClassification::Inaccuracy: s.inaccuracies++; break;
-            default:                             s.good_moves++;  break;
-        }
-    }
-    
-    float acpl = move_count ? (total_cp_loss / move_count) : 0.0f;
-    s.accuracy = 103.1668f * std::exp(-0.00866f * acpl) - 3.1669f;
-    s.accuracy = std::clamp(s.accuracy, 0.0f, 100.0f);
-    
+float moveAccuracy(float win_loss) {
+    // Unlike ACPL, a mate score cannot swamp the average
+    float accuracy = 103.1668f * std::exp(-0.04354f * win_loss) - 3.1669f;
+    return std::clamp(accuracy, 0.0f, 100.0f);
+}
+
+GamePhase gamePhase(const std::string& fen) {
+    std::string placement = fen.substr(0, fen.find(' '));
+    int pieces = 0;
+    for (char c : placement) {
+        switch (std::tolower(c)) {
+            case 'n': case 'b': case 'r': case 'q': pieces++; break;
+        }
+    }
+    if (pieces <= 6) return GamePhase::Endgame;
+
+    // Fewer than four of a side's own pieces left on its back rank
+    auto back_rank = [](const std::string& rank, bool white) {
+        int count = 0;
+        for (char c : rank) {
+            if (std::isalpha((unsigned char)c) && (std::isupper((unsigned char)c) != 0) == white) count++;
+        }
+        return count;
+    };
+    std::string rank8 = placement.substr(0, placement.find('/'));
+    std::string rank1 = placement.substr(placement.rfind('/') + 1);
+    bool sparse = back_rank(rank1, true) < 4 || back_rank(rank8, false) < 4;
+    if (pieces <= 10 || sparse) return GamePhase::Middlegame;
+    return GamePhase::Opening;
+}
+
+const char* phaseName(GamePhase phase) {
+    switch (phase) {
+        case GamePhase::Opening:    return "opening";
+        case GamePhase::Middlegame: return "middlegame";
+        case GamePhase::Endgame:    return "endgame";
+    }
+    return "";
+}
+
+ReviewReport::ReviewReport(size_t plies) : timeline_(plies), accuracy_(plies, 0.0f) {}
+
+ReviewReport ReviewReport::fromReviews(const std::vector<MoveReview>& reviews) {
+    ReviewReport report(reviews.size());
+    for (const auto& r : reviews) report.set(r);
+    return report;
+}
+
+void ReviewReport::set(const MoveReview& review) {
+    if (review.ply < 0) return;
+    size_t ply = (size_t)review.ply;
+    if (ply >= timeline_.size()) {
+        timeline_.resize(ply + 1);
+        accuracy_.resize(ply + 1, 0.0f);
+    }
+    if (timeline_[ply].ready) apply(ply, -1);
+
+    Point& p = timeline_[ply];
+    p = Point{};
+    if (!review.ready) return;
+    p.ready = true;
+    p.eval = review.eval_after;
+    p.white_score = review.win_after;
+    p.classification = review.classification;
+    p.phase = review.phase;
+    accuracy_[ply] = moveAccuracy(review.win_loss);
+    apply(ply, +1);
+}
+
+void ReviewReport::apply(size_t ply, int sign) {
+    const Point& p = timeline_[ply];
+    plies_done_ += sign;
+    if (p.classification == MoveClassification::GameEnd) return;
+
+    Side& s = sides_[ply % 2];
+    float accuracy = sign * accuracy_[ply];
+    s.moves += sign;
+    s.counts[(int)p.classification] += sign;
+    s.accuracy_sum += accuracy;
+    s.phase_moves[(int)p.phase] += sign;
+    s.phase_accuracy_sum[(int)p.phase] += accuracy;
+}
+
+float ReviewReport::Side::accuracy() const {
+    return moves ? std::clamp(accuracy_sum / moves, 0.0f, 100.0f) : 100.0f;
+}
+
+float ReviewReport::Side::phaseAccuracy(GamePhase phase) const {
+    int n = phase_moves[(int)phase];
+    return n ? std::clamp(phase_accuracy_sum[(int)phase] / n, 0.0f, 100.0f) : -1.0f;
+}
+
+ReviewSummary ReviewReport::Side::summary() const {
+    ReviewSummary s;
+    s.blunders = count(MoveClassification::Blunder);
+    s.mistakes = count(MoveClassification::Mistake);
+    s.inaccuracies = count(MoveClassification::Inaccuracy);
+    s.good_moves = moves - s.blunders - s.mistakes - s.inaccuracies;
+    s.accuracy = accuracy();
     return s;
 }
 
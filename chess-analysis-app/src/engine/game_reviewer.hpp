@@ -3,13 +3,20 @@
 #include <string>
 #include <thread>
 #include <algorithm>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <memory>
 #include "stockfish.hpp"
+#include "engine_pool.hpp"
+#include "review_store.hpp"
 #include "../core/game_record.hpp"
 
 namespace Chess {
 
 enum class MoveClassification {
     Brilliant,
+    Great,          // the only move that keeps the evaluation
     Best,
     Excellent,
     Good,
@@ -19,6 +26,13 @@ enum class MoveClassification {
     Book,
     GameEnd
 };
+constexpr int MOVE_CLASSIFICATION_COUNT = (int)MoveClassification::GameEnd + 1;
+
+enum class GamePhase {
+    Opening,
+    Middlegame,
+    Endgame
+};
 
 struct MoveReview {
     int ply;
@@ -27,6 +41,10 @@ struct MoveReview {
     float cp_loss;
     std::string best_move_uci;
     MoveClassification classification;
+    bool ready = true;              // false while a live review has not reached this ply
+    float win_loss = 0.0f;          // mover's expected score lost, in percent
+    float win_after = 50.0f;        // White's expected score after the move, in percent
+    GamePhase phase = GamePhase::Opening;
 };
 
 struct ReviewSummary {
@@ -37,21 +55,202 @@ struct ReviewSummary {
     float accuracy = 0.0f;
 };
 
+// Aggregates of a review, kept up to date ply by ply: set() replaces a
+// ply's earlier contribution, so a live review that re-classifies a ply
+// after a deeper search stays consistent without rescanning.
+class ReviewReport {
+public:
+    struct Side {
+        int moves = 0;
+        int counts[MOVE_CLASSIFICATION_COUNT] = {};
+        float accuracy_sum = 0.0f;
+        int phase_moves[3] = {};
+        float phase_accuracy_sum[3] = {};
+
+        float accuracy() const;
+        // -1 when the side made no move in that phase
+        float phaseAccuracy(GamePhase phase) const;
+        int count(MoveClassification c) const { return counts[(int)c]; }
+        ReviewSummary summary() const;
+    };
+    // One per ply, for the eval graph
+    struct Point {
+        bool ready = false;
+        float eval = 0.0f;          // White's view, centipawns
+        float white_score = 50.0f;  // White's expected score, percent
+        MoveClassification classification = MoveClassification::Good;
+        GamePhase phase = GamePhase::Opening;
+    };
+
+    explicit ReviewReport(size_t plies = 0);
+    static ReviewReport fromReviews(const std::vector<MoveReview>& reviews);
+
+    // Adds the ply, replacing what it contributed before. Entries that are
+    // not ready only clear the ply.
+    void set(const MoveReview& review);
+    // Plies at even indices are White's, as in the move table
+    const Side& side(bool white) const { return sides_[white ? 0 : 1]; }
+    const std::vector<Point>& timeline() const { return timeline_; }
+    int pliesDone() const { return plies_done_; }
+
+private:
+    Side sides_[2];
+    std::vector<Point> timeline_;
+    std::vector<float> accuracy_;   // per ply, as counted
+    int plies_done_ = 0;
+
+    void apply(size_t ply, int sign);
+};
+
+struct ReviewSettings {
+    int depth = 18;                 // every position, or the deep pass when adaptive
+    // Adaptive: a shallow MultiPV-2 pass over all plies, then full depth only
+    // where the verdict could change. Forced moves are never searched.
+    bool adaptive = false;
+    int shallow_depth = 10;
+    float threshold_margin = 0.25f; // fraction of a classifyWinLoss boundary
+    float swing_cp = 150.0f;        // eval change between plies
+    float multipv_gap_cp = 30.0f;   // best vs second best line
+    // Node/time limits for the full-depth searches (deterministic with nodes)
+    uint64_t nodes = 0;
+    int movetime_ms = 0;
+    // Budgets per game instead of per search, spread evenly over the
+    // positions still to search. A node budget searches with "go nodes"
+    // only, so results repeat exactly on any machine with Threads=1. The
+    // time budget is wall time with searches run one after another.
+    uint64_t node_budget = 0;
+    int time_budget_ms = 0;
+    float shallow_share = 0.3f;     // adaptive: part of the budget for the shallow pass
+    // Lines per full search; the alternatives find only moves and sacrifices
+    int multipv = 3;
+    // Single session: positions are searched one after another in game order
+    // (on one engine, keeping its hash). With reuse_best_move, a move that
+    // matches the engine's best move is not searched after: the PV supplies
+    // the next position's eval. Unless the reply played follows the PV as
+    // well: telling whether it was an only move takes a MultiPV search.
+    bool single_session = false;
+    bool reuse_best_move = true;
+};
+
+struct ReviewStats {
+    int positions = 0;
+    int forced_skipped = 0;
+    int shallow_searches = 0;
+    int deep_searches = 0;
+    int reused = 0;                 // positions taken from the previous PV
+    int stored = 0;                 // positions taken from a stored review
+    int failed = 0;                 // searches the engine could not finish
+    uint64_t nodes = 0;
+};
+
+// What the GUI draws from; taken once per frame
+struct ReviewSnapshot {
+    std::shared_ptr<const std::vector<MoveReview>> results;
+    std::shared_ptr<const ReviewReport> report;
+    float progress = 0.0f;
+    bool complete = false;
+    bool running = false;
+    bool failed = false;            // stopped because a search failed; nothing was saved
+};
+
+// Reviews run on a worker owned by the reviewer. Results are published as
+// immutable snapshots, filled in ply by ply while the review runs.
 class GameReviewer {
 public:
-    void startReview(const std::vector<std::string>& fens, Engine::StockfishClient& engine, int depth = 18, const std::string& game_result = "");
+    // Runs one search per listed position into evals[i], in any order or in
+    // parallel, calling done(ok) after each; ok is false when the engine
+    // could not finish that search, and evals[i] is then left alone.
+    using SearchRunner = std::function<void(const std::vector<size_t>& indices, const Engine::SearchLimits& limits,
+                                            std::vector<Engine::EngineResult>& evals, const std::function<void(bool ok)>& done)>;
+
+    GameReviewer();
+    ~GameReviewer();
+    GameReviewer(const GameReviewer&) = delete;
+    GameReviewer& operator=(const GameReviewer&) = delete;
+
+    // fens: every position of the game; uci_moves: the moves between them
+    // (may be empty, then positions are sent as FENs). A review already
+    // running is cancelled first. `engines` must outlive the review; they
+    // are started, and the stored review read, on the review's worker.
+    void startReview(const std::vector<std::string>& fens, const std::vector<std::string>& uci_moves, Engine::EnginePool& engines,
+                     const ReviewSettings& settings = {}, const std::string& game_result = "");
+    // Stops the running review (interrupting its searches) and waits for it
+    void cancel();
+    // Finished reviews are saved here, and a new review of the same game
+    // only searches the positions reusableEvals leaves out
+    void setStore(ReviewStore* store);
+    // Shows the stored review of this game, if any, as a complete review
+    bool restoreReview(const std::vector<std::string>& fens, const std::vector<std::string>& uci_moves, const std::string& game_result = "");
     bool isReviewComplete() const;
+    bool isRunning() const;
     float getProgress() const;
-    const std::vector<MoveReview>& getResults() const { return results_; }
+    std::vector<MoveReview> getResults() const;
+    ReviewSnapshot snapshot() const;
+
+    // Centipawn-loss classification; reviews classify by classifyWinLoss
     MoveClassification classifyMove(float cp_loss, float eval_before);
+    // Engine results for every position under the given settings. Synchronous;
+    // progress goes from 0 to 1. Entries of `known` with a depth are used
+    // as they are instead of being searched. Stops after the pass in which
+    // a search failed, with stats->failed set; the evals are then incomplete.
+    std::vector<Engine::EngineResult> evaluatePositions(const std::vector<std::string>& fens, const std::vector<std::string>& moves,
+                                                        const ReviewSettings& settings, const SearchRunner& run, ReviewStats* stats = nullptr,
+                                                        const std::function<void(float)>& progress = nullptr,
+                                                        const std::vector<Engine::EngineResult>& known = {});
+    // Classifies every move from the engine result of each position
+    // (side-to-move scores, as returned by the engine). Synchronous.
+    std::vector<MoveReview> classifyGame(const std::vector<std::string>& fens, const std::vector<Engine::EngineResult>& evals, const std::string& game_result = "");
 
 private:
-    std::vector<MoveReview> results_;
-    bool complete_ = false;
-    float progress_ = 0.0f;
+    std::thread worker_;
+    Engine::EnginePool* engines_ = nullptr;
+    ReviewStore* store_ = nullptr;
+    std::atomic<bool> cancel_{false};
+    std::atomic<bool> running_{false};
+    std::atomic<bool> complete_{false};
+    std::atomic<bool> failed_{false};
+    std::atomic<float> progress_{0.0f};
+
+    mutable std::mutex results_mutex_;
+    std::shared_ptr<const std::vector<MoveReview>> results_;
+    std::shared_ptr<const ReviewReport> report_;
+
+    void publish(std::shared_ptr<const std::vector<MoveReview>> results, std::shared_ptr<const ReviewReport> report);
+    MoveReview classifyPly(const std::vector<std::string>& fens, const std::vector<Engine::EngineResult>& evals, size_t i, const std::string& game_result);
+    bool nearBoundary(float win_loss, float margin) const;
+    // Whether the move gave up material once the best reply is played
+    bool isSacrifice(const std::string& fen_before, const std::string& fen_after, const std::string& reply) const;
+    Engine::SearchLimits fullLimits(const ReviewSettings& settings) const;
 };
 
+const char* classificationName(MoveClassification c);
+
+// Stockfish's win_rate_model: win chance in per mille for the side to move,
+// from a UCI centipawn score (normalized so 100 cp is a 50% win) and the
+// material on the board (P=1, N=B=3, R=5, Q=9, both sides)
+float winRate(float centipawns, int material);
+// Expected score in percent (win + half the draws), mates at 0 or 100
+float expectedScore(float centipawns, bool is_mate, int material);
+int materialCount(const std::string& fen);
+// Class of a move from the expected score it lost, in percent points
+MoveClassification classifyWinLoss(float win_loss);
+
+// The search settings of a review as one string, saved with the review
+std::string settingsFingerprint(const ReviewSettings& settings);
+// Stored evals a review under `settings` can take as they are; the others
+// come back with depth 0. A review made with the same settings is reused
+// whole, whatever depth each ply needed under them (adaptive and budgeted
+// reviews leave most plies shallow). Otherwise a ply is reused when it
+// reached settings.depth, or not at all when node or time limits apply.
+std::vector<Engine::EngineResult> reusableEvals(const StoredReview& stored, const ReviewSettings& settings);
+
 // Summary computation
 ReviewSummary computeSummary(const std::vector<MoveReview>& reviews, bool white);
+// Accuracy of one move from the expected score it lost, 0-100
+float moveAccuracy(float win_loss);
+// Opening until the pieces thin out or leave the back ranks; endgame
+// with six or fewer queens, rooks and minor pieces left
+GamePhase gamePhase(const std::string& fen);
+const char* phaseName(GamePhase phase);
 
 } // namespace Chess
@@ -0,0 +1,337 @@
+#include "review_scheduler.hpp"
+#include <algorithm>
+
+namespace Chess {
+
+ReviewScheduler::ReviewScheduler(Engine::EnginePool& pool) : ReviewScheduler(pool, Options{}) {}
+
+ReviewScheduler::ReviewScheduler(Engine::EnginePool& pool, Options options) : pool_(&pool), options_(options) {
+    search_ = [this](size_t worker, const std::string& start_fen, const std::vector<std::string>& moves,
+                     const Engine::SearchLimits& limits, Engine::EngineResult& out) {
+        bool ok = false;
+        pool_->withEngine(worker, [&](Engine::EngineSupervisor& engine) { ok = engine.analyze(start_fen, moves, limits, out); });
+        return ok;
+    };
+}
+
+ReviewScheduler::ReviewScheduler(size_t workers, SearchFn search) : ReviewScheduler(workers, std::move(search), Options{}) {}
+
+ReviewScheduler::ReviewScheduler(size_t workers, SearchFn search, Options options)
+    : workers_(workers), search_(std::move(search)), options_(options) {}
+
+ReviewScheduler::~ReviewScheduler() {
+    stop();
+}
+
+size_t ReviewScheduler::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return workers_;
+    if (pool_) workers_ = pool_->size();
+    running_ = true;
+    started_at_ = Clock::now();
+    for (size_t w = 0; w < workers_; ++w) {
+        threads_.emplace_back(&ReviewScheduler::workerLoop, this, w);
+    }
+    startJobs();
+    return workers_;
+}
+
+void ReviewScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+        for (auto& entry : users_) {
+            for (auto& queue : entry.second.queued) {
+                for (auto& job : queue) finishJob(*job, ReviewJobState::Cancelled);
+                queue.clear();
+            }
+        }
+        for (auto& job : active_) {
+            job->cancelled = true;
+            job->outstanding -= job->tasks.size();
+            job->tasks.clear();
+            job->cv.notify_all();
+        }
+    }
+    work_cv_.notify_all();
+    // Searches in flight end early with "stop"
+    if (pool_) pool_->interrupt();
+    for (auto& t : threads_) t.join();
+    threads_.clear();
+
+    std::vector<std::thread> coordinators;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& entry : jobs_) {
+            if (entry.second->coordinator.joinable()) coordinators.push_back(std::move(entry.second->coordinator));
+        }
+    }
+    for (auto& t : coordinators) t.join();
+}
+
+uint64_t ReviewScheduler::submit(const std::string& user, ReviewPriority priority, const std::vector<std::string>& fens,
+                                 const std::vector<std::string>& uci_moves, const ReviewSettings& settings,
+                                 const std::string& game_result) {
+    auto job = std::make_shared<Job>();
+    job->fens = fens;
+    job->uci_moves = uci_moves;
+    job->settings = settings;
+    job->game_result = game_result;
+    job->status.user = user;
+    job->status.priority = priority;
+    job->submitted = Clock::now();
+
+    std::vector<std::thread> finished;
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        id = next_id_++;
+        job->status.id = id;
+        jobs_[id] = job;
+        metrics_.submitted++;
+
+        User& u = users_[user];
+        bool idle = u.running == 0 && u.queued[0].empty() && u.queued[1].empty();
+        if (idle) {
+            // A user coming back starts level with the busy ones, not with
+            // credit for the time it was away
+            double floor = -1.0;
+            for (const auto& entry : users_) {
+                const User& other = entry.second;
+                bool busy = other.running > 0 || !other.queued[0].empty() || !other.queued[1].empty();
+                if (busy && (floor < 0 || other.virtualTime() < floor)) floor = other.virtualTime();
+            }
+            if (floor > u.virtualTime()) u.served = floor * u.weight;
+        }
+        u.queued[(int)priority].push_back(job);
+        startJobs();
+        finished = reap();
+    }
+    for (auto& t : finished) t.join();
+    return id;
+}
+
+void ReviewScheduler::setUserWeight(const std::string& user, double weight) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    User& u = users_[user];
+    // Keep the user's place in line under the new weight
+    double vt = u.virtualTime();
+    u.weight = std::max(weight, 0.001);
+    u.served = vt * u.weight;
+}
+
+bool ReviewScheduler::cancel(uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) return false;
+    Job& job = *it->second;
+    if (job.finished || job.cancelled) return false;
+
+    if (job.status.state == ReviewJobState::Queued) {
+        auto& queue = users_[job.status.user].queued[(int)job.status.priority];
+        queue.erase(std::remove(queue.begin(), queue.end(), it->second), queue.end());
+        finishJob(job, ReviewJobState::Cancelled);
+        return true;
+    }
+    // Searches already handed out finish; the coordinator then stops
+    job.cancelled = true;
+    job.outstanding -= job.tasks.size();
+    job.tasks.clear();
+    job.cv.notify_all();
+    return true;
+}
+
+bool ReviewScheduler::status(uint64_t id, ReviewJobStatus& out) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = jobs_.find(id);
+    if (it == jobs_.end()) return false;
+    fillStatus(*it->second, out);
+    return true;
+}
+
+ReviewScheduler::Metrics ReviewScheduler::getMetrics() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Metrics m = metrics_;
+    m.queued = 0;
+    for (const auto& entry : users_) m.queued += entry.second.queued[0].size() + entry.second.queued[1].size();
+    m.running = active_.size();
+    if (running_) m.uptime_seconds = std::chrono::duration<double>(Clock::now() - started_at_).count();
+    return m;
+}
+
+void ReviewScheduler::workerLoop(size_t worker) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        auto job = pickJob();
+        if (!job) {
+            work_cv_.wait(lock);
+            continue;
+        }
+        Task task = std::move(job->tasks.front());
+        job->tasks.pop_front();
+        lock.unlock();
+
+        // The coordinator waits for this task, so the job and evals stay put
+        Engine::EngineResult res;
+        bool ok;
+        if (job->uci_moves.size() + 1 == job->fens.size()) {
+            std::vector<std::string> played(job->uci_moves.begin(), job->uci_moves.begin() + task.index);
+            ok = search_(worker, job->fens[0], played, task.limits, res);
+        } else {
+            ok = search_(worker, job->fens[task.index], {}, task.limits, res);
+        }
+        if (ok) (*task.evals)[task.index] = res;
+        task.done(ok);
+
+        lock.lock();
+        // Every search counts at least one node, so fixed-depth mock or
+        // cached results still advance the user's share. A failed one
+        // served nobody.
+        if (ok) {
+            users_[job->status.user].served += (double)std::max<uint64_t>(res.nodes, 1);
+            job->status.nodes += res.nodes;
+            metrics_.searches++;
+            metrics_.nodes += res.nodes;
+        }
+        job->outstanding--;
+        job->cv.notify_all();
+    }
+}
+
+void ReviewScheduler::runJob(std::shared_ptr<Job> job) {
+    GameReviewer reviewer;
+    auto run = [&](const std::vector<size_t>& indices, const Engine::SearchLimits& limits,
+                   std::vector<Engine::EngineResult>& evals, const std::function<void(bool)>& done) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (job->cancelled) return;
+        for (size_t i : indices) job->tasks.push_back({i, limits, &evals, done});
+        job->outstanding += indices.size();
+        work_cv_.notify_all();
+        job->cv.wait(lock, [&]() { return job->outstanding == 0; });
+    };
+
+    ReviewStats stats;
+    auto evals = reviewer.evaluatePositions(job->fens, job->uci_moves, job->settings, run, &stats,
+                                            [&](float p) { job->progress = p; });
+    std::vector<MoveReview> results;
+    bool cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelled = job->cancelled;
+    }
+    // Evals of failed searches are missing: no results rather than wrong ones
+    bool failed = !cancelled && stats.failed > 0;
+    if (!cancelled && !failed) results = reviewer.classifyGame(job->fens, evals, job->game_result);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    job->status.stats = stats;
+    job->status.results = std::move(results);
+    ReviewJobState state = ReviewJobState::Done;
+    if (job->cancelled) state = ReviewJobState::Cancelled;
+    else if (failed) state = ReviewJobState::Failed;
+    finishJob(*job, state);
+    startJobs();
+}
+
+void ReviewScheduler::startJobs() {
+    if (!running_) return;
+    for (int c = 0; c < 2; ++c) {
+        size_t limit = workers_;
+        if (c == (int)ReviewPriority::Bulk && options_.max_running_bulk > 0) limit = options_.max_running_bulk;
+        while (running_count_[c] < limit) {
+            // The user furthest behind its share, oldest job first on ties
+            User* next = nullptr;
+            for (auto& entry : users_) {
+                User& u = entry.second;
+                if (u.queued[c].empty()) continue;
+                if (!next || u.virtualTime() < next->virtualTime() ||
+                    (u.virtualTime() == next->virtualTime() && u.queued[c].front()->status.id < next->queued[c].front()->status.id)) {
+                    next = &u;
+                }
+            }
+            if (!next) break;
+
+            auto job = next->queued[c].front();
+            next->queued[c].pop_front();
+            next->running++;
+            running_count_[c]++;
+            job->status.state = ReviewJobState::Running;
+            job->started = Clock::now();
+            job->status.queue_ms = std::chrono::duration<double, std::milli>(job->started - job->submitted).count();
+            metrics_.started[c]++;
+            metrics_.total_queue_ms[c] += job->status.queue_ms;
+            metrics_.max_queue_ms[c] = std::max(metrics_.max_queue_ms[c], job->status.queue_ms);
+            active_.push_back(job);
+            job->coordinator = std::thread(&ReviewScheduler::runJob, this, job);
+        }
+    }
+}
+
+std::shared_ptr<ReviewScheduler::Job> ReviewScheduler::pickJob() {
+    // Interactive first, then the user furthest behind its share
+    std::shared_ptr<Job> best;
+    double best_vt = 0.0;
+    for (const auto& job : active_) {
+        if (job->tasks.empty() || job->cancelled) continue;
+        double vt = users_[job->status.user].virtualTime();
+        if (!best || job->status.priority < best->status.priority ||
+            (job->status.priority == best->status.priority &&
+             (vt < best_vt || (vt == best_vt && job->status.id < best->status.id)))) {
+            best = job;
+            best_vt = vt;
+        }
+    }
+    return best;
+}
+
+void ReviewScheduler::finishJob(Job& job, ReviewJobState state) {
+    bool was_running = job.status.state == ReviewJobState::Running;
+    job.finished = true;
+    job.status.state = state;
+    if (state == ReviewJobState::Done) job.progress = 1.0f;
+    if (was_running) {
+        running_count_[(int)job.status.priority]--;
+        users_[job.status.user].running--;
+        active_.erase(std::remove_if(active_.begin(), active_.end(), [&](const std::shared_ptr<Job>& j) { return j.get() == &job; }),
+                      active_.end());
+    }
+    if (state == ReviewJobState::Done) metrics_.completed++;
+    else if (state == ReviewJobState::Failed) metrics_.failed++;
+    else metrics_.cancelled++;
+    finished_order_.push_back(job.status.id);
+}
+
+std::vector<std::thread> ReviewScheduler::reap() {
+    std::vector<std::thread> threads;
+    for (auto& entry : jobs_) {
+        Job& job = *entry.second;
+        if (job.finished && job.coordinator.joinable()) threads.push_back(std::move(job.coordinator));
+    }
+    // Forget the oldest finished jobs; their coordinators are joined above
+    while (finished_order_.size() > options_.keep_finished) {
+        jobs_.erase(finished_order_.front());
+        finished_order_.pop_front();
+    }
+    return threads;
+}
+
+void ReviewScheduler::fillStatus(const Job& job, ReviewJobStatus& out) const {
+    out = job.status;
+    out.progress = job.progress;
+    if (job.status.state == ReviewJobState::Done) {
+        out.eta_seconds = 0.0;
+        return;
+    }
+    if (job.status.state != ReviewJobState::Running) return;
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - job.started).count();
+    if (elapsed > 0) out.nodes_per_second = job.status.nodes / elapsed;
+    // Nodes still to come, at the share of the engines this job gets now
+    if (out.progress > 0.0f && out.nodes_per_second > 0) {
+        double remaining = job.status.nodes * (1.0 - out.progress) / out.progress;
+        out.eta_seconds = remaining / out.nodes_per_second;
+    }
+}
+
+} // namespace Chess
@@ -0,0 +1,168 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include "game_reviewer.hpp"
+
+namespace Chess {
+
+// Interactive jobs (one game someone is looking at) always run ahead of bulk ones
+enum class ReviewPriority {
+    Interactive = 0,
+    Bulk = 1
+};
+
+enum class ReviewJobState {
+    Queued,
+    Running,
+    Done,
+    Cancelled,
+    Failed          // a search failed even after restarting the engine
+};
+
+struct ReviewJobStatus {
+    uint64_t id = 0;
+    std::string user;
+    ReviewPriority priority = ReviewPriority::Bulk;
+    ReviewJobState state = ReviewJobState::Queued;
+    float progress = 0.0f;
+    double eta_seconds = -1.0;      // from the job's measured nodes/sec; -1 until known
+    uint64_t nodes = 0;
+    double nodes_per_second = 0.0;
+    double queue_ms = 0.0;          // submitted -> started
+    ReviewStats stats;
+    std::vector<MoveReview> results; // once Done
+};
+
+// Review jobs from many users over one set of engines. Each user has a queue
+// per priority class; jobs are started per class in priority order, and the
+// searches of running jobs are handed to free engines one at a time, to the
+// job whose user has received the fewest nodes relative to its weight.
+class ReviewScheduler {
+public:
+    // Runs one search on engine `worker`, with the game as start FEN + moves.
+    // False when the engine could not finish it.
+    using SearchFn = std::function<bool(size_t worker, const std::string& start_fen, const std::vector<std::string>& moves,
+                                        const Engine::SearchLimits& limits, Engine::EngineResult& out)>;
+
+    struct Options {
+        size_t max_running_bulk = 0;    // 0: one bulk job per engine
+        size_t keep_finished = 1000;    // finished jobs kept for status()
+    };
+
+    struct Metrics {
+        uint64_t submitted = 0;
+        uint64_t completed = 0;
+        uint64_t cancelled = 0;
+        uint64_t failed = 0;
+        uint64_t searches = 0;           // finished ones; failed searches are not counted
+        uint64_t nodes = 0;
+        size_t queued = 0;
+        size_t running = 0;
+        // Queue latency per priority class (submitted -> started)
+        uint64_t started[2] = {0, 0};
+        double total_queue_ms[2] = {0.0, 0.0};
+        double max_queue_ms[2] = {0.0, 0.0};
+        double uptime_seconds = 0.0;
+
+        double meanQueueMs(ReviewPriority p) const { int c = (int)p; return started[c] ? total_queue_ms[c] / started[c] : 0.0; }
+        double gamesPerHour() const { return uptime_seconds > 0 ? completed * 3600.0 / uptime_seconds : 0.0; }
+        double nodesPerSecond() const { return uptime_seconds > 0 ? nodes / uptime_seconds : 0.0; }
+    };
+
+    // One worker per engine the pool has running at start()
+    explicit ReviewScheduler(Engine::EnginePool& pool);
+    ReviewScheduler(Engine::EnginePool& pool, Options options);
+    // Workers driven by a search function instead of a pool
+    ReviewScheduler(size_t workers, SearchFn search);
+    ReviewScheduler(size_t workers, SearchFn search, Options options);
+    ~ReviewScheduler();
+    ReviewScheduler(const ReviewScheduler&) = delete;
+    ReviewScheduler& operator=(const ReviewScheduler&) = delete;
+
+    // Returns the number of workers
+    size_t start();
+    // Cancels everything still queued or running and waits for the workers
+    void stop();
+
+    // uci_moves: the moves between fens; without them every position is sent as a FEN
+    uint64_t submit(const std::string& user, ReviewPriority priority, const std::vector<std::string>& fens,
+                    const std::vector<std::string>& uci_moves, const ReviewSettings& settings = {},
+                    const std::string& game_result = "");
+    // Share of the engines relative to other users; default 1
+    void setUserWeight(const std::string& user, double weight);
+    bool cancel(uint64_t id);
+    bool status(uint64_t id, ReviewJobStatus& out) const;
+    Metrics getMetrics() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Task {
+        size_t index;
+        Engine::SearchLimits limits;
+        std::vector<Engine::EngineResult>* evals;
+        std::function<void(bool)> done;
+    };
+    struct Job {
+        ReviewJobStatus status;
+        std::vector<std::string> fens;
+        std::vector<std::string> uci_moves;
+        ReviewSettings settings;
+        std::string game_result;
+        Clock::time_point submitted;
+        Clock::time_point started;
+        std::deque<Task> tasks;
+        size_t outstanding = 0;         // handed out or queued, not finished
+        bool cancelled = false;
+        bool finished = false;
+        std::atomic<float> progress{0.0f};
+        std::thread coordinator;
+        std::condition_variable cv;
+    };
+    struct User {
+        double weight = 1.0;
+        double served = 0.0;            // nodes received
+        std::deque<std::shared_ptr<Job>> queued[2];
+        size_t running = 0;
+        double virtualTime() const { return served / weight; }
+    };
+
+    Engine::EnginePool* pool_ = nullptr;
+    size_t workers_ = 0;
+    SearchFn search_;
+    Options options_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    bool running_ = false;
+    std::vector<std::thread> threads_;
+    std::map<std::string, User> users_;
+    std::map<uint64_t, std::shared_ptr<Job>> jobs_;
+    std::deque<uint64_t> finished_order_;
+    std::vector<std::shared_ptr<Job>> active_;
+    size_t running_count_[2] = {0, 0};
+    uint64_t next_id_ = 1;
+    Metrics metrics_;
+    Clock::time_point started_at_;
+
+    void workerLoop(size_t worker);
+    void runJob(std::shared_ptr<Job> job);
+    // Called with mutex_ held
+    void startJobs();
+    std::shared_ptr<Job> pickJob();
+    void finishJob(Job& job, ReviewJobState state);
+    // Coordinators of finished jobs, to be joined without the lock
+    std::vector<std::thread> reap();
+    void fillStatus(const Job& job, ReviewJobStatus& out) const;
+};
+
+} // namespace Chess
@@ -0,0 +1,137 @@
+#include "review_store.hpp"
+#include "analysis_cache.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace Chess {
+
+namespace {
+
+constexpr uint32_t REVIEW_MAGIC = 0x57565243; // "CRVW"
+constexpr uint32_t REVIEW_VERSION = 2;
+
+struct ReviewFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t recordSize;
+    int32_t depth;
+    uint32_t engineLength;
+    uint32_t settingsLength;
+    uint32_t count;         // positions; each is a CacheRecord plus its lines
+};
+
+// MultiPV line after the position's CacheRecord
+struct LineRecord {
+    int32_t score = 0;
+    int16_t depth = 0;
+    uint8_t is_mate = 0;
+    uint8_t reserved = 0;
+    char move[8] = {};
+};
+
+} // namespace
+
+uint64_t gameKey(const std::string& startFen, const std::vector<std::string>& moves) {
+    // FNV-1a continued from the start position's key
+    uint64_t h = Engine::positionKey(startFen);
+    for (const auto& m : moves) {
+        for (char c : m) {
+            h ^= (unsigned char)c;
+            h *= 1099511628211ULL;
+        }
+        h ^= ' ';
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+ReviewStore::ReviewStore(const std::string& directory) : dir(directory) {}
+
+std::string ReviewStore::pathFor(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.review", (unsigned long long)key);
+    return (std::filesystem::path(dir) / name).string();
+}
+
+bool ReviewStore::load(uint64_t key, StoredReview& out) const {
+    std::ifstream in(pathFor(key), std::ios::binary);
+    if (!in) return false;
+
+    ReviewFileHeader header;
+    if (!in.read((char*)&header, sizeof(header))) return false;
+    if (header.magic != REVIEW_MAGIC || header.version != REVIEW_VERSION ||
+        header.recordSize != sizeof(Engine::CacheRecord) || header.engineLength > 256 || header.settingsLength > 256 ||
+        header.count > 100000) {
+        return false;
+    }
+
+    StoredReview review;
+    review.depth = header.depth;
+    review.engine.resize(header.engineLength);
+    if (!in.read(&review.engine[0], header.engineLength)) return false;
+    review.settings.resize(header.settingsLength);
+    if (!in.read(&review.settings[0], header.settingsLength)) return false;
+
+    review.evals.resize(header.count);
+    for (auto& eval : review.evals) {
+        Engine::CacheRecord rec;
+        uint8_t lineCount = 0;
+        if (!in.read((char*)&rec, sizeof(rec)) || !in.read((char*)&lineCount, 1)) return false;
+        Engine::fromRecord(rec, eval);
+        // The store's own line records follow; they aren't capped in number
+        eval.lines.clear();
+        for (int i = 0; i < lineCount; i++) {
+            LineRecord line;
+            if (!in.read((char*)&line, sizeof(line))) return false;
+            line.move[sizeof(line.move) - 1] = '\0';
+            float cp = line.is_mate ? ((line.score > 0) ? 30000.0f - line.score : -30000.0f - line.score) : (float)line.score;
+            eval.lines.push_back({line.move, cp, line.score, line.is_mate != 0, line.depth});
+        }
+    }
+    out = std::move(review);
+    return true;
+}
+
+bool ReviewStore::save(uint64_t key, const StoredReview& review) const {
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+
+    // Written aside and renamed, so a crash never leaves half a review
+    std::string path = pathFor(key);
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+
+        ReviewFileHeader header = {REVIEW_MAGIC, REVIEW_VERSION, (uint32_t)sizeof(Engine::CacheRecord), review.depth,
+                                   (uint32_t)std::min<size_t>(review.engine.size(), 256),
+                                   (uint32_t)std::min<size_t>(review.settings.size(), 256), (uint32_t)review.evals.size()};
+        out.write((const char*)&header, sizeof(header));
+        out.write(review.engine.data(), header.engineLength);
+        out.write(review.settings.data(), header.settingsLength);
+
+        for (const auto& eval : review.evals) {
+            Engine::CacheRecord rec = Engine::toRecord(0, eval);
+            uint8_t lineCount = (uint8_t)std::min<size_t>(eval.lines.size(), 255);
+            out.write((const char*)&rec, sizeof(rec));
+            out.write((const char*)&lineCount, 1);
+            for (int i = 0; i < lineCount; i++) {
+                const auto& src = eval.lines[i];
+                LineRecord line;
+                line.score = src.score;
+                line.depth = (int16_t)src.depth;
+                line.is_mate = src.is_mate ? 1 : 0;
+                std::strncpy(line.move, src.move.c_str(), sizeof(line.move) - 1);
+                out.write((const char*)&line, sizeof(line));
+            }
+        }
+        if (!out) return false;
+    }
+    std::filesystem::rename(tmp, path, ec);
+    return !ec;
+}
+
+} // namespace Chess
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "stockfish.hpp"
+
+namespace Chess {
+
+// Identifies a game by its start position and the moves played
+uint64_t gameKey(const std::string& startFen, const std::vector<std::string>& moves);
+
+// Engine output of a finished review; classifications are recomputed from it
+struct StoredReview {
+    std::string engine;     // "id name" of the engine that searched it
+    int depth = 0;          // review depth requested (ReviewSettings::depth)
+    std::string settings;   // all search settings, see settingsFingerprint
+    std::vector<Engine::EngineResult> evals; // per position, with its own depth
+};
+
+// Review results on disk, one file per game, so a reopened game shows its
+// review at once and a deeper review searches only the plies that need it.
+class ReviewStore {
+public:
+    explicit ReviewStore(const std::string& directory);
+
+    bool load(uint64_t key, StoredReview& out) const;
+    bool save(uint64_t key, const StoredReview& review) const;
+
+private:
+    std::string dir;
+
+    std::string pathFor(uint64_t key) const;
+};
+
+} // namespace Chess
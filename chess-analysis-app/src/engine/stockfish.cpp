@@ -1,7 +1,12 @@
 #include "stockfish.hpp"
+#include "analysis_cache.hpp"
+#include "../core/board.hpp"
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -9,7 +14,9 @@
 
 namespace Engine {
 
-StockfishClient::StockfishClient(const std::string& path) : exePath(path), isRunning(false) {}
+StockfishClient::StockfishClient(const std::string& path) : exePath(path), isRunning(false) {
+    engineOptions.push_back({"UCI_ShowWDL", "true"});
+}
 
 StockfishClient::~StockfishClient() {
     stop();
@@ -80,11 +87,30 @@ bool StockfishClient::start() {
     // Initialize others to null to be safe? 
     // We reused local vars for creation to avoid casting mess in CreatePipe
 
+    std::vector<std::pair<std::string, std::string>> options;
+    {
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        readySent = 0;
+        readyReceived = 0;
+        options = engineOptions;
+        // A fresh process only knows the replayed options
+        multiPv = 1;
+        for (const auto& opt : engineOptions) {
+            if (opt.first == "MultiPV") multiPv = std::max(1, std::atoi(opt.second.c_str()));
+        }
+    }
+
+    processAlive = true;
     isRunning = true;
     outputThread = std::thread(&StockfishClient::readOutputLoop, this);
     
-    sendCommand("uci");
-    sendCommand("isready");
+    CommandBatch handshake;
+    handshake.add("uci");
+    for (const auto& opt : options) {
+        handshake.add("setoption name " + opt.first + " value " + opt.second);
+    }
+    send(handshake);
+    sendIsReady();
 
     return true;
 #else
@@ -97,52 +123,246 @@ void StockfishClient::stop() {
     
     sendCommand("quit");
     isRunning = false;
-    
+
+#ifdef _WIN32
+    if (hProcess) {
+        // A hung engine ignores "quit"; terminate it rather than leak it
+        if (WaitForSingleObject((HANDLE)hProcess, 1000) == WAIT_TIMEOUT) {
+            TerminateProcess((HANDLE)hProcess, 1);
+            WaitForSingleObject((HANDLE)hProcess, 1000);
+        }
+    }
+#endif
+
+    // The reader sees the pipe close once the process is gone
     if (outputThread.joinable()) outputThread.join();
 
 #ifdef _WIN32
     if (hProcess) {
-        WaitForSingleObject((HANDLE)hProcess, 1000);
         CloseHandle((HANDLE)hProcess);
         hProcess = nullptr;
     }
-    if (hChildStd_IN_Wr) {
-        CloseHandle((HANDLE)hChildStd_IN_Wr);
-        hChildStd_IN_Wr = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        if (hChildStd_IN_Wr) {
+            CloseHandle((HANDLE)hChildStd_IN_Wr);
+            hChildStd_IN_Wr = nullptr;
+        }
     }
     if (hChildStd_OUT_Rd) {
         CloseHandle((HANDLE)hChildStd_OUT_Rd);
          hChildStd_OUT_Rd = nullptr;
     }
 #endif
+    processAlive = false;
+    failPending();
 }
 
-void StockfishClient::sendCommand(const std::string& cmd) {
-    if (!isRunning) return;
-    std::string fullCmd = cmd;
-    if (fullCmd.empty() || fullCmd.back() != '\n') {
-        fullCmd += "\n";
+bool StockfishClient::isAlive() const {
+    return isRunning && processAlive;
+}
+
+uint64_t StockfishClient::sendIsReady() {
+    uint64_t ticket;
+    {
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        ticket = ++readySent;
     }
-#ifdef _WIN32
-    DWORD dwWritten;
-    WriteFile((HANDLE)hChildStd_IN_Wr, fullCmd.c_str(), fullCmd.size(), &dwWritten, NULL);
-#endif
+    sendCommand("isready");
+    return ticket;
 }
 
-void StockfishClient::setPosition(const std::string& fen, const std::vector<std::string>& moves) {
-    std::stringstream ss;
-    ss << "position fen " << fen;
+bool StockfishClient::ping(int timeoutMs) {
+    if (!isAlive()) return false;
+    uint64_t ticket = sendIsReady();
+    std::unique_lock<std::mutex> lock(callbackMutex);
+    readyCv.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&]{
+        return readyReceived >= ticket || !processAlive;
+    });
+    return readyReceived >= ticket;
+}
+
+void StockfishClient::setOption(const std::string& name, const std::string& value) {
+    {
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        bool found = false;
+        for (auto& opt : engineOptions) {
+            if (opt.first == name) {
+                opt.second = value;
+                found = true;
+            }
+        }
+        if (!found) engineOptions.push_back({name, value});
+        if (name == "MultiPV") multiPv = std::max(1, std::atoi(value.c_str()));
+    }
+    sendCommand("setoption name " + name + " value " + value);
+}
+
+std::string StockfishClient::getEngineName() const {
+    std::lock_guard<std::mutex> lock(callbackMutex);
+    return engineName;
+}
+
+// Searches in flight will never see their bestmove: release any waiter
+void StockfishClient::failPending() {
+    std::lock_guard<std::mutex> lock(callbackMutex);
+    pendingSearches.clear();
+    lastInfo = EngineResult{};
+    if (syncMode) {
+        syncMode = false;
+        syncFailed = true;
+        syncCv.notify_all();
+    }
+    readyCv.notify_all();
+}
+
+StockfishClient::CommandBatch& StockfishClient::CommandBatch::add(const std::string& cmd) {
+    buffer += cmd;
+    if (cmd.empty() || cmd.back() != '\n') buffer += '\n';
+    return *this;
+}
+
+StockfishClient::CommandBatch& StockfishClient::CommandBatch::stop() {
+    return add("stop");
+}
+
+StockfishClient::CommandBatch& StockfishClient::CommandBatch::position(const std::string& fen, const std::vector<std::string>& moves) {
+    hasKey = true;
+    key = historyKey(fen, moves);
+    buffer += "position fen ";
+    buffer += fen;
     if (!moves.empty()) {
-        ss << " moves";
+        buffer += " moves";
         for (const auto& m : moves) {
-            ss << " " << m;
+            buffer += ' ';
+            buffer += m;
         }
     }
-    sendCommand(ss.str());
+    buffer += '\n';
+    return *this;
+}
+
+StockfishClient::CommandBatch& StockfishClient::CommandBatch::go(int depth, uint64_t requestId) {
+    return search(SearchLimits::ofDepth(depth), requestId, false);
 }
 
-void StockfishClient::go(int depth) {
-    sendCommand("go depth " + std::to_string(depth));
+StockfishClient::CommandBatch& StockfishClient::CommandBatch::go(const SearchLimits& limits, uint64_t requestId) {
+    return search(limits, requestId, false);
+}
+
+StockfishClient::CommandBatch& StockfishClient::CommandBatch::search(const SearchLimits& limits, uint64_t requestId, bool sync) {
+    if (limits.multiPv > 0) {
+        buffer += "setoption name MultiPV value ";
+        buffer += std::to_string(limits.multiPv);
+        buffer += '\n';
+    }
+    searches.push_back({requestId, sync, hasKey, key, limits.nodes == 0 && limits.movetimeMs <= 0, limits.multiPv});
+    buffer += "go";
+    if (limits.depth > 0 || (limits.nodes == 0 && limits.movetimeMs <= 0)) {
+        buffer += " depth ";
+        buffer += std::to_string(limits.depth > 0 ? limits.depth : 20);
+    }
+    if (limits.nodes > 0) {
+        buffer += " nodes ";
+        buffer += std::to_string(limits.nodes);
+    }
+    if (limits.movetimeMs > 0) {
+        buffer += " movetime ";
+        buffer += std::to_string(limits.movetimeMs);
+    }
+    buffer += '\n';
+    return *this;
+}
+
+void StockfishClient::CommandBatch::clear() {
+    buffer.clear();
+    searches.clear();
+    hasKey = false;
+    key = 0;
+}
+
+// Caller holds writeMutex. Pipes may accept less than asked; keep writing.
+bool StockfishClient::writeAll(const char* data, size_t size) {
+#ifdef _WIN32
+    if (!hChildStd_IN_Wr) return false;
+    while (size > 0) {
+        DWORD chunk = (DWORD)std::min<size_t>(size, 1u << 20);
+        DWORD dwWritten = 0;
+        if (!WriteFile((HANDLE)hChildStd_IN_Wr, data, chunk, &dwWritten, NULL)) {
+            processAlive = false; // Broken pipe: the engine is gone
+            return false;
+        }
+        data += dwWritten;
+        size -= dwWritten;
+    }
+    return true;
+#else
+    (void)data;
+    (void)size;
+    return false;
+#endif
+}
+
+bool StockfishClient::sendCommand(const std::string& cmd) {
+    if (!isRunning) return false;
+    std::lock_guard<std::mutex> lock(writeMutex);
+    commandBuffer.clear();
+    commandBuffer += cmd;
+    if (cmd.empty() || cmd.back() != '\n') commandBuffer += '\n';
+    return writeAll(commandBuffer.data(), commandBuffer.size());
+}
+
+bool StockfishClient::send(CommandBatch& batch) {
+    if (batch.empty()) return true;
+    if (!isRunning) {
+        batch.clear();
+        return false;
+    }
+    bool ok;
+    {
+        // Held across bookkeeping and write so the pending-search order
+        // matches the order the engine receives "go" commands in
+        std::lock_guard<std::mutex> lock(writeMutex);
+        {
+            std::lock_guard<std::mutex> cbLock(callbackMutex);
+            for (const auto& s : batch.searches) {
+                if (s.multiPv > 0) multiPv = s.multiPv;
+                uint64_t key = s.cacheable ? searchKey(s.hasKey ? s.key : currentKey, multiPv) : 0;
+                pendingSearches.push_back({s.requestId, key, s.sync, searchesSent++});
+            }
+            if (batch.hasKey) currentKey = batch.key;
+        }
+        ok = writeAll(batch.buffer.data(), batch.buffer.size());
+    }
+    batch.clear();
+    return ok;
+}
+
+void StockfishClient::addGamePosition(CommandBatch& batch, const std::string& startFen, const std::vector<std::string>& moves) {
+    bool newGame;
+    {
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        newGame = startFen != gameStartFen;
+        gameStartFen = startFen;
+    }
+    if (newGame) batch.add("ucinewgame");
+    batch.position(startFen, moves);
+}
+
+void StockfishClient::setPosition(const std::string& fen, const std::vector<std::string>& moves) {
+    CommandBatch batch;
+    send(batch.position(fen, moves));
+}
+
+void StockfishClient::setGamePosition(const std::string& startFen, const std::vector<std::string>& moves) {
+    CommandBatch batch;
+    addGamePosition(batch, startFen, moves);
+    send(batch);
+}
+
+void StockfishClient::go(int depth, uint64_t requestId) {
+    CommandBatch batch;
+    send(batch.go(depth, requestId));
 }
 
 void StockfishClient::stopAnalysis() {
@@ -154,6 +374,46 @@ void StockfishClient::setEvalCallback(EvalCallback cb) {
     onEval = cb;
 }
 
+void StockfishClient::setSearchCallback(SearchCallback cb) {
+    std::lock_guard<std::mutex> lock(callbackMutex);
+    onSearch = cb;
+}
+
+void StockfishClient::setCache(AnalysisCache* c) {
+    std::lock_guard<std::mutex> lock(callbackMutex);
+    cache = c;
+}
+
+bool StockfishClient::cachedResult(const std::string& fen, int minDepth, EngineResult& out) {
+    return cachedResult(fen, {}, minDepth, 0, out);
+}
+
+bool StockfishClient::cachedResult(const std::string& startFen, const std::vector<std::string>& moves,
+                                   int minDepth, int lines, EngineResult& out) {
+    if (!cache) return false;
+    if (lines <= 0) {
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        lines = multiPv;
+    }
+    return cache->lookup(searchKey(historyKey(startFen, moves), lines), minDepth, out);
+}
+
+bool StockfishClient::analyze(const std::string& fen, int depth) {
+    EngineResult cached;
+    if (cachedResult(fen, depth, cached)) {
+        stopAnalysis();
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        // Info lines of the stopped search may still be on their way; they
+        // must not overwrite the cached answer
+        evalFrom = searchesSent;
+        if (onEval) onEval(formatScore(cached), cached.best_move);
+        return true;
+    }
+    CommandBatch batch;
+    send(batch.stop().position(fen).go(depth));
+    return false;
+}
+
 void StockfishClient::readOutputLoop() {
 #ifdef _WIN32
     const int BUFSIZE = 4096;
@@ -175,48 +435,114 @@ void StockfishClient::readOutputLoop() {
             if ((line.compare(0, 4, "info") == 0 && line.find("score") != std::string_view::npos) ||
                 line.compare(0, 8, "bestmove") == 0) {
                 parseOutput(std::string(line));
+            } else if (line == "readyok") {
+                std::lock_guard<std::mutex> lock(callbackMutex);
+                readyReceived++;
+                readyCv.notify_all();
+            } else if (line.compare(0, 8, "id name ") == 0) {
+                std::lock_guard<std::mutex> lock(callbackMutex);
+                engineName = std::string(line.substr(8));
             }
             pos = nextPos + 1;
         }
         buffer.erase(0, pos);
     } 
 #endif
+    // Crashed or closed: nothing more will arrive for pending searches
+    processAlive = false;
+    failPending();
 }
 
-void StockfishClient::parseOutput(const std::string& line) {
-    // Example: info depth 10 seldepth 14 multipv 1 score cp 32 nodes 1234 nps 4321 hashfull 0 tbhits 0 time 5 pv e2e4 e7e5
+bool parseInfoLine(const std::string& line, EngineResult& out) {
+    // Example: info depth 10 seldepth 14 multipv 1 score cp 32 wdl 120 850 30 nodes 1234 nps 4321 hashfull 0 tbhits 0 time 5 pv e2e4 e7e5
     // info depth 20 ... score mate 3 ...
-    
-    if (line.rfind("info", 0) == 0 && line.find("score") != std::string::npos) {
-        std::string score = "";
-        std::string bestMove = ""; // "pv" usually follows
-        float current_cp = 0.0f;
-        
-        std::istringstream iss(line);
-        std::string token;
-        while (iss >> token) {
-            if (token == "score") {
-                std::string type;
-                int val;
-                iss >> type >> val;
-                if (type == "cp") {
-                    score = (val > 0 ? "+" : "") + std::to_string((float)val / 100.0f);
-                    current_cp = (float)val;
-                } else if (type == "mate") {
-                    score = "#" + std::to_string(val);
-                    current_cp = (val > 0) ? 30000.0f - val : -30000.0f - val;
-                }
+    if (line.rfind("info", 0) != 0) return false;
+
+    bool hasScore = false;
+    std::istringstream iss(line);
+    std::string token;
+    while (iss >> token) {
+        if (token == "depth") {
+            iss >> out.depth;
+        } else if (token == "multipv") {
+            iss >> out.multipv;
+        } else if (token == "score") {
+            std::string type;
+            int val = 0;
+            iss >> type >> val;
+            hasScore = true;
+            out.score = val;
+            if (type == "cp") {
+                out.is_mate = false;
+                out.centipawns = (float)val;
+            } else if (type == "mate") {
+                out.is_mate = true;
+                out.centipawns = (val > 0) ? 30000.0f - val : -30000.0f - val;
             }
-             else if (token == "pv") {
-                 iss >> bestMove; // First move of PV
-             }
+        } else if (token == "lowerbound") {
+            out.bound = ScoreBound::Lower;
+        } else if (token == "upperbound") {
+            out.bound = ScoreBound::Upper;
+        } else if (token == "nodes") {
+            iss >> out.nodes;
+        } else if (token == "nps") {
+            iss >> out.nps;
+        } else if (token == "wdl") {
+            iss >> out.wdl[0] >> out.wdl[1] >> out.wdl[2];
+        } else if (token == "pv") {
+            // The PV runs to the end of the line
+            std::string mv;
+            while (iss >> mv) out.pv.push_back(mv);
         }
-        
+    }
+    if (!out.pv.empty()) out.best_move = out.pv[0];
+    return hasScore;
+}
+
+std::string applyUciMoves(const std::string& fen, const std::vector<std::string>& moves) {
+    Chess::Board board(fen);
+    for (const auto& m : moves) {
+        if (!board.makeMove(Chess::Move::fromString(m))) break;
+    }
+    return board.getFen();
+}
+
+std::string formatScore(const EngineResult& result) {
+    if (result.is_mate) return "#" + std::to_string(result.score);
+    return (result.score > 0 ? "+" : "") + std::to_string((float)result.score / 100.0f);
+}
+
+void StockfishClient::parseOutput(const std::string& line) {
+    if (line.rfind("info", 0) == 0) {
+        EngineResult info;
+        if (!parseInfoLine(line, info)) return;
+
         // Callback
         std::lock_guard<std::mutex> lock(callbackMutex);
-        if (onEval) onEval(score, bestMove);
-        if (syncMode) {
-            syncResult.centipawns = current_cp;
+        PendingSearch owner = pendingSearches.empty() ? PendingSearch{0, 0, false, 0} : pendingSearches.front();
+        if (onEval && owner.seq >= evalFrom) onEval(formatScore(info), info.best_move);
+        if (onSearch) onSearch(owner.requestId, info, false);
+        if (info.multipv >= 1 && info.multipv <= 256) {
+            // Bound-only updates never replace an exact score
+            auto& lines = lastInfo.lines;
+            if (lines.size() < (size_t)info.multipv) lines.resize(info.multipv);
+            PvLine& slot = lines[info.multipv - 1];
+            if (info.bound == ScoreBound::Exact || slot.depth == 0) {
+                slot = {info.best_move, info.centipawns, info.score, info.is_mate, info.depth, info.pv};
+            }
+        }
+        if (info.multipv == 1) {
+            if (info.bound == ScoreBound::Exact || lastInfo.bound != ScoreBound::Exact || lastInfo.depth == 0) {
+                std::vector<PvLine> lines = std::move(lastInfo.lines);
+                lastInfo = info;
+                lastInfo.lines = std::move(lines);
+            }
+        } else {
+            // Node counts keep growing while the secondary lines are printed
+            lastInfo.nodes = std::max(lastInfo.nodes, info.nodes);
+        }
+        if (owner.sync && syncMode) {
+            syncResult = lastInfo;
         }
     } else if (line.rfind("bestmove", 0) == 0) {
         std::istringstream iss(line);
@@ -224,7 +550,20 @@ void StockfishClient::parseOutput(const std::string& line) {
         iss >> token >> bmove;
         
         std::lock_guard<std::mutex> lock(callbackMutex);
-        if (syncMode) {
+        PendingSearch owner = {0, 0, false, 0};
+        if (!pendingSearches.empty()) {
+            owner = pendingSearches.front();
+            pendingSearches.pop_front();
+        }
+        lastInfo.best_move = bmove;
+        if (cache && owner.key != 0 && lastInfo.depth > 0) {
+            cache->store(owner.key, lastInfo);
+        }
+        if (onSearch) onSearch(owner.requestId, lastInfo, true);
+        lastInfo = EngineResult{};
+
+        // A stopped background search must not complete a blocking request
+        if (owner.sync && syncMode) {
             syncResult.best_move = bmove;
             syncMode = false;
             syncCv.notify_all();
@@ -233,19 +572,62 @@ void StockfishClient::parseOutput(const std::string& line) {
 }
 
 EngineResult StockfishClient::analyzePosition(const std::string& fen, int depth) {
+    return analyzePosition(fen, {}, depth);
+}
+
+EngineResult StockfishClient::analyzePosition(const std::string& startFen, const std::vector<std::string>& moves, int depth) {
+    EngineResult result;
+    tryAnalyzePosition(startFen, moves, depth, 0, result);
+    return result;
+}
+
+StockfishClient::SearchStatus StockfishClient::tryAnalyzePosition(const std::string& startFen, const std::vector<std::string>& moves,
+                                                                  int depth, int timeoutMs, EngineResult& out) {
+    return tryAnalyzePosition(startFen, moves, SearchLimits::ofDepth(depth), timeoutMs, out);
+}
+
+StockfishClient::SearchStatus StockfishClient::tryAnalyzePosition(const std::string& startFen, const std::vector<std::string>& moves,
+                                                                  const SearchLimits& limits, int timeoutMs, EngineResult& out) {
+    if (limits.depth > 0 && limits.nodes == 0 && limits.movetimeMs <= 0 &&
+        cachedResult(startFen, moves, limits.depth, limits.multiPv, out)) {
+        return SearchStatus::Ok;
+    }
+    if (!isAlive()) return SearchStatus::Failed;
+
     {
         std::lock_guard<std::mutex> lock(callbackMutex);
         syncMode = true;
+        syncFailed = false;
         syncResult = EngineResult{};
     }
 
-    sendCommand("position fen " + fen);
-    sendCommand("go depth " + std::to_string(depth));
+    CommandBatch batch;
+    if (moves.empty()) {
+        batch.position(startFen);
+    } else {
+        addGamePosition(batch, startFen, moves);
+    }
+    send(batch.search(limits, 0, true));
 
     std::unique_lock<std::mutex> lock(callbackMutex);
-    syncCv.wait(lock, [this]{ return !syncMode; });
-    
-    return syncResult;
+    auto finished = [this]{ return !syncMode; };
+    SearchStatus status = SearchStatus::Ok;
+    if (timeoutMs <= 0) {
+        syncCv.wait(lock, finished);
+    } else if (!syncCv.wait_for(lock, std::chrono::milliseconds(timeoutMs), finished)) {
+        // Watchdog: cut the search short and give the engine a grace period
+        status = SearchStatus::TimedOut;
+        lock.unlock();
+        stopAnalysis();
+        lock.lock();
+        if (!syncCv.wait_for(lock, std::chrono::milliseconds(1000), finished)) {
+            syncMode = false;
+            syncFailed = true;
+        }
+    }
+
+    out = syncResult;
+    return syncFailed ? SearchStatus::Failed : status;
 }
 
 } // namespace Engine
@@ -6,14 +6,62 @@
 #include <vector>
 #include <mutex>
 #include <condition_variable>
+#include <deque>
+#include <cstdint>
 
 namespace Engine {
 
+enum class ScoreBound : uint8_t {
+    Exact = 0,
+    Lower = 1,
+    Upper = 2
+};
+
+// One MultiPV line; lines[0] is the principal variation
+struct PvLine {
+    std::string move;           // first move of the line
+    float centipawns = 0.0f;
+    int score = 0;
+    bool is_mate = false;
+    int depth = 0;
+    std::vector<std::string> pv{};
+};
+
 struct EngineResult {
     float centipawns = 0.0f;
     std::string best_move;
+    int depth = 0;
+    int multipv = 1;
+    int score = 0;              // raw UCI value: centipawns, or moves to mate
+    bool is_mate = false;
+    ScoreBound bound = ScoreBound::Exact;
+    int wdl[3] = {0, 0, 0};     // per mille, side to move
+    std::vector<std::string> pv;
+    uint64_t nodes = 0;
+    uint64_t nps = 0;
+    std::vector<PvLine> lines;  // latest line per multipv index
 };
 
+// Limits of one search. Unset (0) fields are not sent; with none set the
+// search runs to depth 20.
+struct SearchLimits {
+    int depth = 0;
+    uint64_t nodes = 0;     // deterministic for a fixed engine build and Threads=1
+    int movetimeMs = 0;
+    int multiPv = 0;        // sets MultiPV for this search; 0 keeps the engine's setting
+
+    static SearchLimits ofDepth(int d) { SearchLimits l; l.depth = d; return l; }
+};
+
+// Parses an "info ... score ..." line. Returns false if it carries no score.
+bool parseInfoLine(const std::string& line, EngineResult& out);
+// Eval bar text, e.g. "+0.32" or "#-3"
+std::string formatScore(const EngineResult& result);
+// FEN reached by playing UCI moves from a start position
+std::string applyUciMoves(const std::string& fen, const std::vector<std::string>& moves);
+
+class AnalysisCache;
+
 class StockfishClient {
 public:
     StockfishClient(const std::string& path = "stockfish.exe");
@@ -21,38 +69,150 @@ public:
 
     bool start();
     void stop();
+    // Process is running and its output pipe is still open
+    bool isAlive() const;
+    // "isready" -> "readyok" round trip; false on timeout or a dead process
+    bool ping(int timeoutMs);
+    // Sent now and replayed after every (re)start
+    void setOption(const std::string& name, const std::string& value);
+    // From the engine's "id name" reply, e.g. "Stockfish 17"; empty before start
+    std::string getEngineName() const;
     
-    // Non-blocking commands
-    void sendCommand(const std::string& cmd);
+    // A group of commands written to the engine with a single write, so it
+    // never interleaves with commands sent from other threads. clear() keeps
+    // the buffer, so a long-lived batch does not allocate per use.
+    class CommandBatch {
+    public:
+        CommandBatch& add(const std::string& cmd);
+        CommandBatch& stop();
+        CommandBatch& position(const std::string& fen, const std::vector<std::string>& moves = {});
+        CommandBatch& go(int depth, uint64_t requestId = 0);
+        CommandBatch& go(const SearchLimits& limits, uint64_t requestId = 0);
+        void clear();
+        bool empty() const { return buffer.empty(); }
+        const std::string& data() const { return buffer; }
+
+    private:
+        friend class StockfishClient;
+        struct Search {
+            uint64_t requestId;
+            bool sync;
+            bool hasKey;    // a position was set earlier in this batch
+            uint64_t key;
+            bool cacheable; // depth-limited; node and time limits aren't cached
+            int multiPv;
+        };
+        std::string buffer;
+        std::vector<Search> searches;
+        bool hasKey = false;
+        uint64_t key = 0;
+
+        CommandBatch& search(const SearchLimits& limits, uint64_t requestId, bool sync);
+    };
+
+    // Non-blocking commands. Return false if the engine could not be written to.
+    bool sendCommand(const std::string& cmd);
+    bool send(CommandBatch& batch); // Clears the batch once written
+    // Adds "ucinewgame" (only when the start position changed) and the position
+    void addGamePosition(CommandBatch& batch, const std::string& startFen, const std::vector<std::string>& moves);
     void setPosition(const std::string& fen, const std::vector<std::string>& moves = {});
-    void go(int depth = 20);
+    // Position inside a game: start FEN + moves played. The engine keeps its
+    // hash across plies and sees the history for repetition draws;
+    // "ucinewgame" is only sent when the start position changes.
+    void setGamePosition(const std::string& startFen, const std::vector<std::string>& moves);
+    // requestId tags every info/bestmove of this search in the SearchCallback
+    void go(int depth = 20, uint64_t requestId = 0);
     void stopAnalysis();
 
+    // Cache-aware analysis: answers from the cache when it holds a result of
+    // at least `depth`, otherwise restarts the search. Returns true on a hit.
+    bool analyze(const std::string& fen, int depth);
+
     // Blocking analysis for Game Review
     EngineResult analyzePosition(const std::string& fen, int depth);
+    EngineResult analyzePosition(const std::string& startFen, const std::vector<std::string>& moves, int depth);
+
+    // Blocking analysis with a watchdog (timeoutMs <= 0 waits indefinitely).
+    // TimedOut: the search was stopped early, out holds the partial result.
+    // Failed: no bestmove arrived, the engine is hung or gone.
+    enum class SearchStatus { Ok, TimedOut, Failed };
+    SearchStatus tryAnalyzePosition(const std::string& startFen, const std::vector<std::string>& moves,
+                                    int depth, int timeoutMs, EngineResult& out);
+    // Same with node/time limits. Only depth-limited searches are answered
+    // from the cache, since a cached result says nothing about node counts.
+    SearchStatus tryAnalyzePosition(const std::string& startFen, const std::vector<std::string>& moves,
+                                    const SearchLimits& limits, int timeoutMs, EngineResult& out);
+
+    // Finished searches are stored here; lookups skip the engine entirely
+    void setCache(AnalysisCache* cache);
+    bool cachedResult(const std::string& fen, int minDepth, EngineResult& out);
+    // Position inside a game, searched with `multiPv` lines (0: the engine's
+    // current setting). Misses when the moves repeat a position.
+    bool cachedResult(const std::string& startFen, const std::vector<std::string>& moves,
+                      int minDepth, int multiPv, EngineResult& out);
 
     // Callbacks
     using EvalCallback = std::function<void(const std::string& score, const std::string& bestMove)>;
     void setEvalCallback(EvalCallback cb);
 
+    // Structured output of tagged searches. `final` is set on "bestmove",
+    // with info holding the last multipv-1 line and best_move filled in.
+    // Runs on the reader thread; must not call back into the client.
+    using SearchCallback = std::function<void(uint64_t requestId, const EngineResult& info, bool final)>;
+    void setSearchCallback(SearchCallback cb);
+
 private:
     std::string exePath;
     std::atomic<bool> isRunning;
+    std::atomic<bool> processAlive{false};
     std::thread outputThread;
+    std::mutex writeMutex; // Guards the stdin handle and commandBuffer
+    std::string commandBuffer;
+
+    std::vector<std::pair<std::string, std::string>> engineOptions;
     
     EvalCallback onEval;
-    std::mutex callbackMutex;
+    SearchCallback onSearch;
+    mutable std::mutex callbackMutex;
+    std::string engineName;
     
     // Sync analysis state
     std::condition_variable syncCv;
     bool syncMode = false;
+    bool syncFailed = false;
     EngineResult syncResult;
 
+    // isready tickets
+    std::condition_variable readyCv;
+    uint64_t readySent = 0;
+    uint64_t readyReceived = 0;
+
+    // Searches still awaiting "bestmove", oldest first. Output always
+    // belongs to the front entry, even after it was told to stop.
+    struct PendingSearch {
+        uint64_t requestId;
+        uint64_t key;   // cache key, 0 if unknown
+        bool sync;      // started by analyzePosition
+        uint64_t seq;   // order sent, see evalFrom
+    };
+    AnalysisCache* cache = nullptr;
+    uint64_t currentKey = 0;
+    std::string gameStartFen;
+    std::deque<PendingSearch> pendingSearches;
+    uint64_t searchesSent = 0;
+    int multiPv = 1;            // as last sent to the engine
+    uint64_t evalFrom = 0;      // searches sent before this no longer feed onEval
+    EngineResult lastInfo;
+
+    uint64_t sendIsReady();
+    void failPending();
+
     // Use void* to avoid including windows.h in header (Raylib conflict)
     void* hChildStd_IN_Wr = nullptr;
     void* hChildStd_OUT_Rd = nullptr;
     void* hProcess = nullptr;
 
+    bool writeAll(const char* data, size_t size);
     void readOutputLoop();
     void parseOutput(const std::string& line);
 };
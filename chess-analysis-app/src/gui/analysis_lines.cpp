@@ -0,0 +1,115 @@
+#include "analysis_lines.hpp"
+#include "../core/board.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace Gui {
+
+namespace {
+
+// Move number and side to move, from the last fields of a FEN
+void moveNumberOf(const std::string& fen, int& number, bool& whiteToMove) {
+    std::istringstream iss(fen);
+    std::string placement, side, castling, ep;
+    int halfmove = 0;
+    number = 1;
+    iss >> placement >> side >> castling >> ep >> halfmove >> number;
+    whiteToMove = side != "b";
+    if (number < 1) number = 1;
+}
+
+} // namespace
+
+PvFormatter::PvFormatter() : worker_(&PvFormatter::run, this) {}
+
+PvFormatter::~PvFormatter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_all();
+    worker_.join();
+}
+
+void PvFormatter::submit(const std::string& fen, const AnalysisSnapshot& analysis) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pendingFen_ = fen;
+        pendingAnalysis_ = analysis;
+        pending_ = true;
+    }
+    cv_.notify_one();
+}
+
+void PvFormatter::run() {
+    std::string fen;
+    AnalysisSnapshot analysis;
+    std::string lines[AnalysisSnapshot::MAX_LINES];
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return pending_ || !running_; });
+            if (!running_) return;
+            fen = pendingFen_;
+            analysis = pendingAnalysis_;
+            pending_ = false;
+        }
+
+        int count = std::min(analysis.lineCount, AnalysisSnapshot::MAX_LINES);
+        for (int i = 0; i < count; i++) lines[i] = format(fen, analysis.lines[i]);
+
+        output_.publish([&](PvText& t) {
+            t.requestId = analysis.requestId;
+            t.analysisSequence = analysis.sequence;
+            t.version = ++version_;
+            t.lineCount = count;
+            for (int i = 0; i < count; i++) {
+                std::memset(t.lines[i], 0, sizeof(t.lines[i]));
+                std::strncpy(t.lines[i], lines[i].c_str(), sizeof(t.lines[i]) - 1);
+            }
+        });
+    }
+}
+
+std::string PvFormatter::format(const std::string& fen, const AnalysisLine& line) {
+    if (fen.empty()) return "";
+    int number;
+    bool whiteToMove;
+    moveNumberOf(fen, number, whiteToMove);
+
+    Chess::Board board(fen);
+    std::string text;
+    std::string key;
+    for (int i = 0; i < line.pvLength; i++) {
+        const char* uci = line.pv[i];
+        key = board.getFen();
+        key += ' ';
+        key += uci;
+
+        Chess::Move m = Chess::Move::fromString(uci);
+        auto it = sanCache_.find(key);
+        if (it == sanCache_.end()) {
+            // Only moves the position allows are cached; a bad line ends here
+            std::vector<Chess::Move> legal = board.getLegalMoves();
+            auto found = std::find_if(legal.begin(), legal.end(), [&](const Chess::Move& lm) {
+                return lm.from == m.from && lm.dest == m.dest && lm.promotion == m.promotion;
+            });
+            if (found == legal.end()) break;
+            if (sanCache_.size() >= MAX_CACHED) sanCache_.clear();
+            it = sanCache_.emplace(key, board.moveToSan(*found)).first;
+        }
+
+        if (whiteToMove) text += std::to_string(number) + ". ";
+        else if (i == 0) text += std::to_string(number) + "... ";
+        text += it->second;
+        text += ' ';
+        board.makeMove(m);
+        if (!whiteToMove) number++;
+        whiteToMove = !whiteToMove;
+    }
+    if (!text.empty()) text.pop_back();
+    return text;
+}
+
+} // namespace Gui
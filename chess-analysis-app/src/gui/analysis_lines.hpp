@@ -0,0 +1,90 @@
+#pragma once
+#include "snapshot_channel.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace Gui {
+
+// One MultiPV line as the engine sent it
+struct AnalysisLine {
+    static constexpr int MAX_PV = 20;
+    int depth = 0;
+    int score = 0;              // centipawns or moves to mate, side to move
+    bool isMate = false;
+    int pvLength = 0;
+    char pv[MAX_PV][6] = {};    // UCI moves; longer lines are cut
+};
+
+// Latest engine output for the position on screen. Fixed size, so handing
+// it from the engine thread to a frame copies no heap memory.
+struct AnalysisSnapshot {
+    static constexpr int MAX_LINES = 3;
+    uint64_t requestId = 0;
+    uint64_t sequence = 0;      // updates received; 0 before the first
+    // Main line
+    int depth = 0;
+    int score = 0;              // centipawns or moves to mate, side to move
+    bool isMate = false;
+    bool final = false;         // the search of this request is done
+    int wdl[3] = {0, 0, 0};     // per mille, side to move; zeros if not reported
+    char bestMove[6] = "";
+    char eval[16] = "N/A";      // score as shown
+    // Every line, the main one first
+    int lineCount = 0;
+    AnalysisLine lines[MAX_LINES];
+};
+
+// The lines of one snapshot in SAN, numbered from the analysed position
+struct PvText {
+    static constexpr int MAX_CHARS = 192;
+    uint64_t requestId = 0;
+    uint64_t analysisSequence = 0;  // the snapshot these lines were made from
+    uint64_t version = 0;           // texts published so far
+    int lineCount = 0;
+    char lines[AnalysisSnapshot::MAX_LINES][MAX_CHARS] = {};
+};
+
+// Turns principal variations into SAN on its own thread, so long lines at
+// high update rates cost the engine and UI threads nothing. Only the newest
+// submission is formatted; SAN is cached per position and move, so a line
+// that grows by a ply converts one new move.
+class PvFormatter {
+public:
+    PvFormatter();
+    ~PvFormatter();
+    PvFormatter(const PvFormatter&) = delete;
+    PvFormatter& operator=(const PvFormatter&) = delete;
+
+    // Any thread; fen is the position the lines start from
+    void submit(const std::string& fen, const AnalysisSnapshot& analysis);
+
+    // Consumer thread only, like SnapshotChannel
+    bool refresh() { return output_.refresh(); }
+    const PvText& latest() const { return output_.latest(); }
+
+private:
+    static constexpr size_t MAX_CACHED = 50000;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool running_ = true;
+    bool pending_ = false;
+    std::string pendingFen_;
+    AnalysisSnapshot pendingAnalysis_;
+
+    // Worker only
+    std::unordered_map<std::string, std::string> sanCache_;   // "<fen> <uci>" -> SAN
+    uint64_t version_ = 0;
+
+    SnapshotChannel<PvText> output_;
+    std::thread worker_;
+
+    void run();
+    std::string format(const std::string& fen, const AnalysisLine& line);
+};
+
+} // namespace Gui
@@ -0,0 +1,433 @@
+#include "app_model.hpp"
+#include "frame_profiler.hpp"
+#include "../core/pgn.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace Gui {
+
+namespace {
+
+const char* START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Parse a PGN and replay it into the record, leaving both at the last move
+void loadPgnToRecord(const std::string& pgn, Chess::Board& board, Chess::GameRecord& record) {
+    PROFILE_SCOPE("load pgn");
+    board.loadPgn(pgn);
+    std::vector<Chess::Move> moves = board.getHistoryMoves();
+    record.reset();
+    board.reset();
+    for (const auto& m : moves) {
+        std::string san = board.moveToSan(m);
+        record.addMove(m, san);
+        board.makeMove(m);
+    }
+}
+
+Chess::ReviewSnapshot emptyReview() {
+    Chess::ReviewSnapshot snap;
+    snap.results = std::make_shared<const std::vector<Chess::MoveReview>>();
+    snap.report = std::make_shared<const Chess::ReviewReport>();
+    return snap;
+}
+
+} // namespace
+
+AppModel::AppModel(AppHooks hooks) : hooks_(std::move(hooks)) {
+    // Unwired hooks do nothing, so a test only sets the ones it checks
+    if (!hooks_.analyze) hooks_.analyze = [](const std::string&, const std::vector<std::string>&) { return uint64_t(0); };
+    if (!hooks_.cancelAnalysis) hooks_.cancelAnalysis = []() {};
+    if (!hooks_.startReview) hooks_.startReview = [](const std::vector<std::string>&, const std::vector<std::string>&, const std::string&) {};
+    if (!hooks_.restoreReview) hooks_.restoreReview = [](const std::vector<std::string>&, const std::vector<std::string>&, const std::string&) { return false; };
+    if (!hooks_.cancelReview) hooks_.cancelReview = []() {};
+    if (!hooks_.reviewSnapshot) hooks_.reviewSnapshot = []() { return emptyReview(); };
+
+    board_.reset();
+    initialFen_ = board_.getFen();
+    pasteText_ = std::make_shared<const std::string>();
+    engineMessage_ = std::make_shared<const std::string>();
+    sanMoves_ = std::make_shared<const std::vector<std::string>>();
+    review_ = hooks_.reviewSnapshot();
+}
+
+void AppModel::handle(const AppEvent& event) {
+    PROFILE_SCOPE("model");
+    bool changed = true;
+    // The paste dialog is modal
+    if (showPasteDialog_) {
+        switch (event.type) {
+            case AppEventType::Tick:
+            case AppEventType::ClosePasteDialog:
+            case AppEventType::SetPasteText:
+            case AppEventType::FileDropped:
+            case AppEventType::SubmitPaste:
+            case AppEventType::EngineReady:
+            case AppEventType::EngineFailed:
+                break;
+            default:
+                return;
+        }
+    }
+
+    switch (event.type) {
+        case AppEventType::Tick:
+            changed = tick(event.dt);
+            break;
+        case AppEventType::SquareClicked:
+            changed = clickSquare(event.square);
+            break;
+        case AppEventType::FlipBoard:
+            flipped_ = !flipped_;
+            break;
+        case AppEventType::Reload:
+            reload();
+            break;
+        case AppEventType::StartReview:
+            // Clicking again restarts a running review
+            if (analysisActive_) startReview();
+            else changed = false;
+            break;
+        case AppEventType::First:
+            changed = record_.hasPrev();
+            while (takeBack()) {}
+            if (changed) navigated();
+            break;
+        case AppEventType::Prev:
+            changed = takeBack();
+            if (changed) navigated();
+            break;
+        case AppEventType::Next:
+            changed = !anim_.active && playRecorded(true);
+            if (changed) navigated();
+            break;
+        case AppEventType::Last:
+            changed = record_.hasNext();
+            while (playRecorded(false)) {}
+            if (changed) navigated();
+            break;
+        case AppEventType::ScrollTable: {
+            int numRows = ((int)sanMoves_->size() + 1) / 2;
+            tableScroll_ = std::clamp(tableScroll_ + event.amount, 0, std::max(0, numRows - visibleRows_));
+            break;
+        }
+        case AppEventType::OpenPasteDialog:
+            changed = !analysisActive_;
+            if (changed) showPasteDialog_ = true;
+            break;
+        case AppEventType::ClosePasteDialog:
+            showPasteDialog_ = false;
+            pasteText_ = std::make_shared<const std::string>();
+            break;
+        case AppEventType::SetPasteText:
+            changed = !event.text.empty();
+            if (changed) pasteText_ = std::make_shared<const std::string>(event.text);
+            break;
+        case AppEventType::FileDropped:
+            pasteText_ = std::make_shared<const std::string>(event.text);
+            showPasteDialog_ = true;
+            selectedSq_ = Chess::SQUARE_NONE;
+            break;
+        case AppEventType::SubmitPaste:
+            changed = !pasteText_->empty();
+            if (changed) submitPaste();
+            break;
+        case AppEventType::EngineReady:
+        case AppEventType::EngineFailed:
+            engineStatus_ = event.type == AppEventType::EngineReady ? EngineStatus::Ready : EngineStatus::Failed;
+            engineMessage_ = std::make_shared<const std::string>(event.text);
+            break;
+    }
+    if (changed) revision_++;
+}
+
+void AppModel::onAnalysis(const Engine::AnalysisUpdate& update) {
+    PROFILE_SCOPE("engine callback");
+    const Engine::EngineResult& info = update.info;
+    int index = info.multipv - 1;
+    if (index < 0 || index >= AnalysisSnapshot::MAX_LINES) return;
+    std::string eval = Engine::formatScore(info);
+
+    AnalysisSnapshot published;
+    analysis_.publish([&](AnalysisSnapshot& a) {
+        AnalysisSnapshot& d = analysisDraft_;
+        // Lines build up per request: each info line brings one of them
+        if (d.requestId != update.requestId || d.sequence == 0) {
+            uint64_t sequence = d.sequence;
+            d = AnalysisSnapshot();
+            d.requestId = update.requestId;
+            d.sequence = sequence;
+        }
+        d.sequence++;
+
+        AnalysisLine& line = d.lines[index];
+        line = AnalysisLine();
+        line.depth = info.depth;
+        line.score = info.score;
+        line.isMate = info.is_mate;
+        for (const auto& mv : info.pv) {
+            if (line.pvLength == AnalysisLine::MAX_PV) break;
+            std::strncpy(line.pv[line.pvLength++], mv.c_str(), sizeof(line.pv[0]) - 1);
+        }
+        // A final result may carry the best move without its PV
+        if (line.pvLength == 0 && !info.best_move.empty()) {
+            std::strncpy(line.pv[line.pvLength++], info.best_move.c_str(), sizeof(line.pv[0]) - 1);
+        }
+        d.lineCount = std::max(d.lineCount, index + 1);
+
+        if (index == 0) {
+            d.depth = info.depth;
+            d.score = info.score;
+            d.isMate = info.is_mate;
+            d.final = update.final;
+            std::copy(info.wdl, info.wdl + 3, d.wdl);
+            std::memset(d.bestMove, 0, sizeof(d.bestMove));
+            std::strncpy(d.bestMove, info.best_move.c_str(), sizeof(d.bestMove) - 1);
+            std::memset(d.eval, 0, sizeof(d.eval));
+            std::strncpy(d.eval, eval.c_str(), sizeof(d.eval) - 1);
+        }
+        a = d;
+        published = d;
+    });
+    pvFormatter_.submit(update.fen, published);
+}
+
+void AppModel::setVisibleRows(int rows) {
+    visibleRows_ = std::max(rows, 1);
+    followCurrentMove();
+}
+
+AppSnapshot AppModel::snapshot() const {
+    PROFILE_SCOPE("snapshot");
+    AppSnapshot s;
+    for (int i = 0; i < 64; i++) s.squares[i] = board_.getPiece(i);
+    s.turn = board_.getTurn();
+    s.selectedSq = selectedSq_;
+    s.flipped = flipped_;
+    s.anim = anim_;
+    s.analysisActive = analysisActive_;
+    s.showPasteDialog = showPasteDialog_;
+    s.pasteText = pasteText_;
+    s.sanMoves = sanMoves_;
+    s.currentIndex = record_.currentIndex;
+    s.tableScroll = tableScroll_;
+    s.reviewState = reviewState_;
+    s.engineStatus = engineStatus_;
+    s.engineMessage = engineMessage_;
+    s.review = review_;
+    analysis_.refresh();
+    s.analysis = analysis_.latest();
+    s.analysisCurrent = analysisRequest_ != 0 && s.analysis.requestId == analysisRequest_;
+    pvFormatter_.refresh();
+    s.pvText = pvFormatter_.latest();
+    // The counters only grow, so the sum changes when any does
+    s.revision = revision_ + s.analysis.sequence + s.pvText.version;
+    return s;
+}
+
+bool AppModel::tick(float dt) {
+    bool changed = false;
+    // One consistent view of the review per frame
+    Chess::ReviewSnapshot review = hooks_.reviewSnapshot();
+    if (review.results != review_.results || review.progress != review_.progress || review.complete != review_.complete ||
+        review.failed != review_.failed) {
+        changed = true;
+    }
+    review_ = std::move(review);
+    if (reviewState_ == ReviewState::REVIEWING && (review_.complete || review_.failed)) {
+        reviewState_ = review_.complete ? ReviewState::REVIEW_DONE : ReviewState::REVIEW_FAILED;
+        triggerAnalysis();
+        changed = true;
+    }
+
+    if (anim_.active) {
+        anim_.progress += dt * anim_.speed;
+        if (anim_.progress >= 1.0f) anim_.active = false;
+        changed = true;
+    }
+    return changed;
+}
+
+bool AppModel::clickSquare(Chess::Square sq) {
+    if (anim_.active || reviewState_ == ReviewState::REVIEWING) return false;
+    if (sq < 0 || sq >= 64) return false;
+
+    if (selectedSq_ == Chess::SQUARE_NONE) {
+        Chess::Piece p = board_.getPiece(sq);
+        if (p == Chess::NO_PIECE || Chess::colorOf(p) != board_.getTurn()) return false;
+        selectedSq_ = sq;
+        return true;
+    }
+
+    Chess::Move m;
+    m.from = selectedSq_;
+    m.dest = sq;
+    m.promotion = Chess::NO_PIECE_TYPE;
+
+    Chess::Piece p = board_.getPiece(selectedSq_);
+    if (Chess::typeOf(p) == Chess::PAWN) {
+        int r = sq / 8;
+        if (r == 0 || r == 7) m.promotion = Chess::QUEEN;
+    }
+
+    std::vector<Chess::Move> legal;
+    {
+        PROFILE_SCOPE("legal moves");
+        legal = board_.getLegalMoves();
+    }
+    bool found = false;
+    for (const auto& lm : legal) {
+        if (lm.from == m.from && lm.dest == m.dest && (m.promotion == Chess::NO_PIECE_TYPE || lm.promotion == m.promotion)) {
+            m = lm;
+            found = true;
+            break;
+        }
+    }
+
+    if (!found) {
+        Chess::Piece target = board_.getPiece(sq);
+        if (target != Chess::NO_PIECE && Chess::colorOf(target) == board_.getTurn()) {
+            selectedSq_ = sq;
+        } else {
+            selectedSq_ = Chess::SQUARE_NONE;
+        }
+        return true;
+    }
+
+    // Replaying the recorded move keeps the rest of the game
+    bool recorded = false;
+    if (record_.hasNext()) {
+        Chess::Move nextRec = record_.moves[record_.currentIndex];
+        recorded = nextRec.from == m.from && nextRec.dest == m.dest && nextRec.promotion == m.promotion;
+    }
+    if (recorded) {
+        record_.currentIndex++;
+    } else {
+        PROFILE_SCOPE("record move");
+        record_.addMove(m, board_.moveToSan(m));
+        recordChanged();
+    }
+
+    animate(m, p);
+    board_.makeMove(m);
+    navigated();
+    return true;
+}
+
+bool AppModel::playRecorded(bool animated) {
+    if (!record_.hasNext()) return false;
+    Chess::Move m = record_.next();
+    if (animated) animate(m, board_.getPiece(m.from));
+    else anim_.active = false;
+    board_.makeMove(m);
+    return true;
+}
+
+bool AppModel::takeBack() {
+    if (!record_.hasPrev()) return false;
+    board_.undoMove();
+    record_.prev();
+    anim_.active = false;
+    return true;
+}
+
+void AppModel::navigated() {
+    triggerAnalysis();
+    selectedSq_ = Chess::SQUARE_NONE;
+    followCurrentMove();
+}
+
+void AppModel::animate(const Chess::Move& m, Chess::Piece piece) {
+    anim_.active = true;
+    anim_.piece = piece;
+    anim_.from = m.from;
+    anim_.dest = m.dest;
+    anim_.progress = 0.0f;
+}
+
+void AppModel::submitPaste() {
+    const std::string& text = *pasteText_;
+    showPasteDialog_ = false;
+    if (text.find("[Event") != std::string::npos || text.find("1.") != std::string::npos) {
+        initialFen_ = START_FEN;
+        loadPgnToRecord(text, board_, record_);
+    } else {
+        board_.loadFen(text);
+        initialFen_ = board_.getFen(); // Normalized, safe to send to the engine
+        record_.reset();
+    }
+    recordChanged();
+    anim_.active = false;
+    analysisActive_ = true;
+    hooks_.cancelReview();
+    reviewState_ = ReviewState::IDLE;
+    if (!record_.moves.empty()) {
+        // A game reviewed before shows its review right away
+        std::vector<std::string> fens;
+        std::vector<std::string> uciMoves;
+        gamePositions(fens, uciMoves);
+        if (hooks_.restoreReview(fens, uciMoves, Chess::pgnTag(text, "Result"))) {
+            reviewState_ = ReviewState::REVIEW_DONE;
+            review_ = hooks_.reviewSnapshot();
+        }
+    }
+    triggerAnalysis();
+    selectedSq_ = Chess::SQUARE_NONE;
+}
+
+void AppModel::reload() {
+    board_.loadFen(initialFen_);
+    record_.reset();
+    recordChanged();
+    anim_.active = false;
+    analysisActive_ = false;
+    hooks_.cancelReview();
+    reviewState_ = ReviewState::IDLE;
+    triggerAnalysis();
+    selectedSq_ = Chess::SQUARE_NONE;
+}
+
+void AppModel::startReview() {
+    std::vector<std::string> fens;
+    std::vector<std::string> uciMoves;
+    gamePositions(fens, uciMoves);
+    hooks_.cancelAnalysis();
+    analysisRequest_ = 0;
+    hooks_.startReview(fens, uciMoves, Chess::pgnTag(*pasteText_, "Result"));
+    reviewState_ = ReviewState::REVIEWING;
+    review_ = hooks_.reviewSnapshot();
+}
+
+void AppModel::triggerAnalysis() {
+    if (reviewState_ == ReviewState::REVIEWING) return;
+    analysisRequest_ = hooks_.analyze(initialFen_, record_.getMoveStrings());
+}
+
+void AppModel::recordChanged() {
+    sanMoves_ = std::make_shared<const std::vector<std::string>>(record_.sanMoves);
+    followCurrentMove();
+}
+
+void AppModel::followCurrentMove() {
+    int numRows = ((int)record_.sanMoves.size() + 1) / 2;
+    if (numRows <= visibleRows_) {
+        tableScroll_ = 0;
+        return;
+    }
+    int currentRow = record_.currentIndex / 2;
+    if (currentRow > tableScroll_ + visibleRows_ - 1) tableScroll_ = currentRow - visibleRows_ + 1;
+    if (currentRow < tableScroll_) tableScroll_ = currentRow;
+    tableScroll_ = std::clamp(tableScroll_, 0, numRows - visibleRows_);
+}
+
+void AppModel::gamePositions(std::vector<std::string>& fens, std::vector<std::string>& uciMoves) const {
+    Chess::Board tempBoard;
+    tempBoard.loadFen(initialFen_);
+    fens.push_back(tempBoard.getFen());
+    for (const auto& m : record_.moves) {
+        tempBoard.makeMove(m);
+        fens.push_back(tempBoard.getFen());
+        uciMoves.push_back(m.toString());
+    }
+}
+
+} // namespace Gui
@@ -0,0 +1,161 @@
+#pragma once
+#include "../core/board.hpp"
+#include "../core/game_record.hpp"
+#include "../engine/analysis_scheduler.hpp"
+#include "../engine/game_reviewer.hpp"
+#include "analysis_lines.hpp"
+#include "snapshot_channel.hpp"
+#include <array>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Gui {
+
+// REVIEW_FAILED: the engines could not search the game; the plies reviewed
+// before that stay on screen
+enum class ReviewState { IDLE, REVIEWING, REVIEW_DONE, REVIEW_FAILED };
+
+// The interactive engine starts in the background; the panel shows where it is
+enum class EngineStatus { Starting, Ready, Failed };
+
+// A piece sliding between two squares; the view turns squares into pixels
+struct MoveAnimation {
+    bool active = false;
+    Chess::Piece piece = Chess::NO_PIECE;
+    Chess::Square from = Chess::SQUARE_NONE;
+    Chess::Square dest = Chess::SQUARE_NONE;
+    float progress = 0.0f; // 0.0 to 1.0
+    float speed = 8.0f;
+};
+
+enum class AppEventType {
+    Tick,               // dt: seconds since the last frame
+    SquareClicked,      // square
+    FlipBoard,
+    Reload,
+    StartReview,
+    First,
+    Prev,
+    Next,
+    Last,
+    ScrollTable,        // amount: rows, negative scrolls up
+    OpenPasteDialog,
+    ClosePasteDialog,
+    SetPasteText,       // text: clipboard contents
+    FileDropped,        // text: file contents
+    SubmitPaste,
+    EngineReady,        // text: engine name
+    EngineFailed        // text: what went wrong
+};
+
+struct AppEvent {
+    AppEventType type;
+    float dt = 0.0f;
+    Chess::Square square = Chess::SQUARE_NONE;
+    int amount = 0;
+    std::string text{};
+};
+
+// What the model asks of the outside world. main() wires these to the
+// analysis scheduler and the game reviewer; tests record the calls.
+struct AppHooks {
+    // Returns the request id its updates will carry, or 0
+    std::function<uint64_t(const std::string& startFen, const std::vector<std::string>& moves)> analyze;
+    std::function<void()> cancelAnalysis;
+    std::function<void(const std::vector<std::string>& fens, const std::vector<std::string>& uciMoves,
+                       const std::string& result)> startReview;
+    std::function<bool(const std::vector<std::string>& fens, const std::vector<std::string>& uciMoves,
+                       const std::string& result)> restoreReview;
+    std::function<void()> cancelReview;
+    std::function<Chess::ReviewSnapshot()> reviewSnapshot;
+};
+
+// Everything a frame draws. Large members are shared, so taking one per
+// frame copies no move lists.
+struct AppSnapshot {
+    std::array<Chess::Piece, 64> squares;
+    Chess::Side turn = Chess::White;
+    Chess::Square selectedSq = Chess::SQUARE_NONE;
+    bool flipped = false;
+    MoveAnimation anim;
+    bool analysisActive = false;
+    bool showPasteDialog = false;
+    std::shared_ptr<const std::string> pasteText;
+    std::shared_ptr<const std::vector<std::string>> sanMoves;
+    int currentIndex = 0;
+    int tableScroll = 0;
+    ReviewState reviewState = ReviewState::IDLE;
+    Chess::ReviewSnapshot review;
+    EngineStatus engineStatus = EngineStatus::Starting;
+    std::shared_ptr<const std::string> engineMessage;   // name, or the failure
+    AnalysisSnapshot analysis;
+    bool analysisCurrent = false;   // the analysis is of the position shown
+    PvText pvText;
+    uint64_t revision = 0;  // changes whenever anything above does
+};
+
+// Board, game record, review and analysis state of the GUI, changed only
+// through events, so the logic runs and can be timed without a window.
+class AppModel {
+public:
+    explicit AppModel(AppHooks hooks);
+
+    void handle(const AppEvent& event);
+    // From engine threads; never waits on the UI
+    void onAnalysis(const Engine::AnalysisUpdate& update);
+    // Rows of the move table on screen, for keeping the current move in view
+    void setVisibleRows(int rows);
+
+    // UI thread only: it takes the latest analysis off the channel
+    AppSnapshot snapshot() const;
+
+    const Chess::Board& board() const { return board_; }
+    const Chess::GameRecord& record() const { return record_; }
+    ReviewState reviewState() const { return reviewState_; }
+    const std::string& initialFen() const { return initialFen_; }
+
+private:
+    AppHooks hooks_;
+    Chess::Board board_;
+    Chess::GameRecord record_;
+    std::string initialFen_;
+    Chess::Square selectedSq_ = Chess::SQUARE_NONE;
+    bool flipped_ = false;
+    MoveAnimation anim_;
+    bool analysisActive_ = false;
+    bool showPasteDialog_ = false;
+    std::shared_ptr<const std::string> pasteText_;
+    std::shared_ptr<const std::vector<std::string>> sanMoves_;
+    int tableScroll_ = 0;
+    int visibleRows_ = 1;
+    ReviewState reviewState_ = ReviewState::IDLE;
+    Chess::ReviewSnapshot review_;
+    uint64_t revision_ = 0;
+
+    EngineStatus engineStatus_ = EngineStatus::Starting;
+    std::shared_ptr<const std::string> engineMessage_;
+    uint64_t analysisRequest_ = 0;
+    mutable SnapshotChannel<AnalysisSnapshot> analysis_;
+    AnalysisSnapshot analysisDraft_;    // producers only, under the channel's writer lock
+    mutable PvFormatter pvFormatter_;
+
+    bool tick(float dt);
+    bool clickSquare(Chess::Square sq);
+    // One step through the record; navigated() then settles the rest
+    bool playRecorded(bool animated);
+    bool takeBack();
+    void navigated();
+    void animate(const Chess::Move& m, Chess::Piece piece);
+    void submitPaste();
+    void reload();
+    void startReview();
+    void triggerAnalysis();
+    void recordChanged();
+    void followCurrentMove();
+    // Every position of the current game and the moves between them
+    void gamePositions(std::vector<std::string>& fens, std::vector<std::string>& uciMoves) const;
+};
+
+} // namespace Gui
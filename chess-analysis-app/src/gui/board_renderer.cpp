@@ -0,0 +1,176 @@
+#include "board_renderer.hpp"
+#include "frame_profiler.hpp"
+#include "layout.hpp"
+#include "render_layer.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace Gui {
+
+using namespace Layout;
+
+namespace {
+
+// Square corner inside a layer, which starts at the board's corner
+Vector2 layerOrigin(Chess::Square sq, bool flipped) {
+    const Geometry& g = current();
+    Vector2 pos = squareOrigin(sq, flipped);
+    return { pos.x - g.boardX, pos.y - g.boardY };
+}
+
+} // namespace
+
+Vector2 squareOrigin(Chess::Square sq, bool flipped) {
+    int r = sq / 8;
+    int f = sq % 8;
+    int drawR = flipped ? r : (7 - r);
+    int drawF = flipped ? (7 - f) : f;
+    const Geometry& g = current();
+    return { (float)(g.boardX + drawF * g.squareSize), (float)(g.boardY + drawR * g.squareSize) };
+}
+
+Chess::Square squareAt(Vector2 pos, bool flipped) {
+    const Geometry& g = current();
+    if (pos.x < g.boardX || pos.x >= g.boardX + g.boardSize ||
+        pos.y < g.boardY || pos.y >= g.boardY + g.boardSize) {
+        return Chess::SQUARE_NONE;
+    }
+    int uiF = (int)(pos.x - g.boardX) / g.squareSize;
+    int uiR = (int)(pos.y - g.boardY) / g.squareSize;
+    int file = flipped ? (7 - uiF) : uiF;
+    int rank = flipped ? uiR : (7 - uiR);
+    return rank * 8 + file;
+}
+
+void drawMoveArrow(const char* uci, bool flipped, Color color) {
+    Chess::Move m = Chess::Move::fromString(uci);
+    if (m.from < 0 || m.from >= 64 || m.dest < 0 || m.dest >= 64 || m.from == m.dest) return;
+
+    float square = (float)current().squareSize;
+    float half = square / 2.0f;
+    Vector2 from = squareOrigin(m.from, flipped);
+    Vector2 to = squareOrigin(m.dest, flipped);
+    from = { from.x + half, from.y + half };
+    to = { to.x + half, to.y + half };
+
+    float dx = to.x - from.x;
+    float dy = to.y - from.y;
+    float len = std::sqrt(dx * dx + dy * dy);
+    dx /= len;
+    dy /= len;
+    float headLen = square * 0.35f;
+    float headHalf = square * 0.2f;
+    Vector2 base = { to.x - dx * headLen, to.y - dy * headLen };
+
+    DrawLineEx(from, base, square * 0.14f, color);
+    // Raylib wants the corners counter-clockwise on screen
+    Vector2 left = { base.x + dy * headHalf, base.y - dx * headHalf };
+    Vector2 right = { base.x - dy * headHalf, base.y + dx * headHalf };
+    float cross = (left.x - to.x) * (right.y - to.y) - (left.y - to.y) * (right.x - to.x);
+    if (cross < 0) DrawTriangle(to, left, right, color);
+    else DrawTriangle(to, right, left, color);
+}
+
+void BoardRenderer::update(const AppSnapshot& s, const PieceAtlas& atlas) {
+    PROFILE_SCOPE("board layers");
+    int size = current().boardSize;
+    if (squares_.id == 0 || squares_.texture.width != size) {
+        // New board size: both layers start over at it
+        unload();
+        squares_ = LoadRenderTexture(size, size);
+        position_ = LoadRenderTexture(size, size);
+    }
+    if (!squaresValid_ || s.flipped != flipped_) {
+        renderSquares(s.flipped);
+        positionValid_ = false;
+    }
+
+    // The moving piece is drawn on its way there, not on its square
+    Chess::Square hidden = s.anim.active ? s.anim.dest : Chess::SQUARE_NONE;
+    if (!positionValid_ || s.squares != pieces_ || s.selectedSq != selected_ || hidden != hidden_) {
+        renderPosition(s, atlas);
+    }
+}
+
+void BoardRenderer::draw(const AppSnapshot& s, const PieceAtlas& atlas) const {
+    PROFILE_SCOPE("draw board");
+    const Geometry& g = current();
+    drawLayer(position_, { (float)g.boardX, (float)g.boardY });
+
+    if (s.anim.active) {
+        Vector2 start = squareOrigin(s.anim.from, s.flipped);
+        Vector2 end = squareOrigin(s.anim.dest, s.flipped);
+        Vector2 pos;
+        pos.x = start.x + (end.x - start.x) * s.anim.progress;
+        pos.y = start.y + (end.y - start.y) * s.anim.progress;
+        atlas.draw(s.anim.piece, pos, (float)g.squareSize);
+    }
+}
+
+void BoardRenderer::invalidate() {
+    squaresValid_ = false;
+    positionValid_ = false;
+}
+
+void BoardRenderer::unload() {
+    if (squares_.id != 0) UnloadRenderTexture(squares_);
+    if (position_.id != 0) UnloadRenderTexture(position_);
+    squares_ = {};
+    position_ = {};
+    invalidate();
+}
+
+void BoardRenderer::renderSquares(bool flipped) {
+    const Geometry& g = current();
+    int square = g.squareSize;
+    int labelSize = std::max(10, square * 16 / 100);
+    beginLayer(squares_);
+    ClearBackground(COLOR_BG);
+    for (int r = 0; r < 8; r++) {
+        for (int f = 0; f < 8; f++) {
+            Color c = ((r + f) % 2 == 0) ? COLOR_DARK : COLOR_LIGHT;
+            Vector2 pos = layerOrigin(r * 8 + f, flipped);
+            DrawRectangle((int)pos.x, (int)pos.y, square, square, c);
+
+            // Files along the bottom edge, ranks along the left, in the
+            // other square color
+            Color label = ((r + f) % 2 == 0) ? COLOR_LIGHT : COLOR_DARK;
+            if (r == (flipped ? 7 : 0)) {
+                char file[2] = { (char)('a' + f), '\0' };
+                DrawText(file, (int)pos.x + square - labelSize * 7 / 8, (int)pos.y + square - labelSize * 9 / 8, labelSize, label);
+            }
+            if (f == (flipped ? 7 : 0)) {
+                char rank[2] = { (char)('1' + r), '\0' };
+                DrawText(rank, (int)pos.x + labelSize / 4, (int)pos.y + labelSize / 5, labelSize, label);
+            }
+        }
+    }
+    endLayer();
+    flipped_ = flipped;
+    squaresValid_ = true;
+}
+
+void BoardRenderer::renderPosition(const AppSnapshot& s, const PieceAtlas& atlas) {
+    Chess::Square hidden = s.anim.active ? s.anim.dest : Chess::SQUARE_NONE;
+    int square = current().squareSize;
+
+    beginLayer(position_);
+    drawLayer(squares_, { 0, 0 });
+    if (s.selectedSq != Chess::SQUARE_NONE) {
+        Vector2 pos = layerOrigin(s.selectedSq, s.flipped);
+        DrawRectangle((int)pos.x, (int)pos.y, square, square, COLOR_SELECTED);
+    }
+    for (int i = 0; i < 64; i++) {
+        Chess::Piece p = s.squares[i];
+        if (p == Chess::NO_PIECE || i == hidden) continue;
+        atlas.draw(p, layerOrigin(i, s.flipped), (float)square);
+    }
+    endLayer();
+
+    pieces_ = s.squares;
+    selected_ = s.selectedSq;
+    hidden_ = hidden;
+    positionValid_ = true;
+}
+
+} // namespace Gui
@@ -0,0 +1,49 @@
+#pragma once
+#include "raylib.h"
+#include "app_model.hpp"
+#include "piece_atlas.hpp"
+#include <array>
+
+namespace Gui {
+
+// Top-left corner of a square on screen
+Vector2 squareOrigin(Chess::Square sq, bool flipped);
+// Square under a point on the board, or SQUARE_NONE
+Chess::Square squareAt(Vector2 pos, bool flipped);
+// Arrow along a UCI move, e.g. an engine's suggestion
+void drawMoveArrow(const char* uci, bool flipped, Color color);
+
+// Draws the board from two cached layers. The squares with their coordinates
+// change only on flip or resize; the position layer (squares, selection and
+// pieces) only when the position, selection or moving piece does. A frame is
+// then one texture plus the piece in flight.
+class BoardRenderer {
+public:
+    BoardRenderer() = default;
+    BoardRenderer(const BoardRenderer&) = delete;
+    BoardRenderer& operator=(const BoardRenderer&) = delete;
+
+    // Re-renders the layers the snapshot made stale; call outside BeginDrawing
+    void update(const AppSnapshot& s, const PieceAtlas& atlas);
+    void draw(const AppSnapshot& s, const PieceAtlas& atlas) const;
+    // Rebuild both layers on the next update; a new board size in the
+    // current layout is picked up without this
+    void invalidate();
+    // Needs the window still open
+    void unload();
+
+private:
+    RenderTexture2D squares_ = {};
+    RenderTexture2D position_ = {};
+    bool squaresValid_ = false;
+    bool positionValid_ = false;
+    bool flipped_ = false;
+    std::array<Chess::Piece, 64> pieces_;
+    Chess::Square selected_ = Chess::SQUARE_NONE;
+    Chess::Square hidden_ = Chess::SQUARE_NONE;
+
+    void renderSquares(bool flipped);
+    void renderPosition(const AppSnapshot& s, const PieceAtlas& atlas);
+};
+
+} // namespace Gui
@@ -0,0 +1,149 @@
+#include "frame_profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace Gui {
+
+namespace {
+
+double toMs(FrameProfiler::Clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+int64_t toUs(FrameProfiler::Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+// Nearest-rank percentile; sorts part of values
+double percentile(std::vector<double>& values, double p) {
+    if (values.empty()) return 0.0;
+    double rank = std::ceil(std::clamp(p, 0.0, 1.0) * values.size() - 1e-9);
+    size_t idx = (size_t)std::max(rank, 1.0) - 1;
+    std::nth_element(values.begin(), values.begin() + idx, values.end());
+    return values[idx];
+}
+
+} // namespace
+
+FrameProfiler& profiler() {
+    static FrameProfiler instance;
+    return instance;
+}
+
+void FrameProfiler::beginFrame() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Spans since the last drawn frame (idle polling) belong to no frame
+    for (auto& s : scopes_) s.current = 0.0;
+    frameStart_ = Clock::now();
+}
+
+void FrameProfiler::endFrame() {
+    Clock::time_point end = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tracing_) traceLocked("frame", frameStart_, end);
+    pushFrame(toMs(end - frameStart_));
+}
+
+void FrameProfiler::addFrame(double ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pushFrame(ms);
+}
+
+void FrameProfiler::pushFrame(double ms) {
+    size_t slot = frameCount_ % HISTORY;
+    frames_[slot] = ms;
+    for (auto& s : scopes_) {
+        s.history[slot] = s.current;
+        s.current = 0.0;
+    }
+    frameCount_++;
+}
+
+void FrameProfiler::record(const char* name, Clock::time_point start, Clock::time_point end) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find_if(scopes_.begin(), scopes_.end(), [&](const Scope& s) {
+        return s.name == name || std::strcmp(s.name, name) == 0;
+    });
+    if (it == scopes_.end()) {
+        scopes_.push_back({ name, 0.0, std::vector<double>(HISTORY, 0.0) });
+        it = scopes_.end() - 1;
+    }
+    it->current += toMs(end - start);
+    if (tracing_) traceLocked(name, start, end);
+}
+
+void FrameProfiler::traceLocked(const char* name, Clock::time_point start, Clock::time_point end) {
+    if (trace_.size() >= MAX_TRACE_EVENTS) return;
+    std::thread::id id = std::this_thread::get_id();
+    auto it = std::find(threads_.begin(), threads_.end(), id);
+    if (it == threads_.end()) it = threads_.insert(threads_.end(), id);
+    int tid = (int)(it - threads_.begin()) + 1;
+    trace_.push_back({ name, toUs(start - epoch_), toUs(end - start), tid });
+}
+
+size_t FrameProfiler::samplesLocked() const {
+    return std::min(frameCount_, HISTORY);
+}
+
+double FrameProfiler::framePercentile(double p) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<double> values(frames_.begin(), frames_.begin() + samplesLocked());
+    return percentile(values, p);
+}
+
+std::vector<FrameProfiler::ScopeStats> FrameProfiler::scopeStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<ScopeStats> stats;
+    std::vector<double> values;
+    for (const auto& s : scopes_) {
+        values.assign(s.history.begin(), s.history.begin() + samplesLocked());
+        ScopeStats st;
+        st.name = s.name;
+        st.p50 = percentile(values, 0.5);
+        st.p99 = percentile(values, 0.99);
+        stats.push_back(st);
+    }
+    return stats;
+}
+
+void FrameProfiler::startTrace() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    trace_.clear();
+    tracing_ = true;
+}
+
+void FrameProfiler::stopTrace() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tracing_ = false;
+}
+
+bool FrameProfiler::tracing() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tracing_;
+}
+
+std::string FrameProfiler::traceJson() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ostringstream out;
+    out << "{\"traceEvents\":[";
+    for (size_t i = 0; i < trace_.size(); i++) {
+        const TraceEvent& e = trace_[i];
+        if (i > 0) out << ",";
+        out << "\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"ts\":" << e.startUs
+            << ",\"dur\":" << e.durUs << ",\"pid\":1,\"tid\":" << e.tid << "}";
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return out.str();
+}
+
+bool FrameProfiler::writeTrace(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+    file << traceJson();
+    return (bool)file;
+}
+
+} // namespace Gui
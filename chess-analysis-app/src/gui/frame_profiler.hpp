@@ -0,0 +1,101 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Gui {
+
+// Where frame time goes. Timed spans are summed per name within each frame;
+// the last HISTORY frames give rolling percentiles for the overlay, and a
+// trace capture keeps every span for chrome://tracing or Perfetto.
+//
+// Only PROFILE_SCOPE and code under CHESS_PROFILER feed it, so a build
+// without that flag contains no timing at all.
+class FrameProfiler {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t HISTORY = 240;
+    static constexpr size_t MAX_TRACE_EVENTS = 1 << 20;
+
+    struct ScopeStats {
+        const char* name;
+        double p50;  // milliseconds per frame
+        double p99;
+    };
+
+    void beginFrame();
+    void endFrame();
+    // A frame measured elsewhere, in milliseconds
+    void addFrame(double ms);
+    // One timed span, from any thread. name must outlive the profiler
+    void record(const char* name, Clock::time_point start, Clock::time_point end);
+
+    // Over the last HISTORY frames; 0 before the first one
+    double framePercentile(double p) const;
+    // Per-frame totals of each span name, in first-seen order
+    std::vector<ScopeStats> scopeStats() const;
+
+    // Spans are kept from startTrace() until stopTrace()
+    void startTrace();
+    void stopTrace();
+    bool tracing() const;
+    // Chrome trace-event JSON of the captured spans
+    std::string traceJson() const;
+    bool writeTrace(const std::string& path) const;
+
+private:
+    struct Scope {
+        const char* name;
+        double current = 0.0;
+        std::vector<double> history;
+    };
+    struct TraceEvent {
+        const char* name;
+        int64_t startUs;
+        int64_t durUs;
+        int tid;
+    };
+
+    mutable std::mutex mutex_;
+    Clock::time_point epoch_ = Clock::now();
+    Clock::time_point frameStart_;
+    std::vector<double> frames_ = std::vector<double>(HISTORY, 0.0);
+    size_t frameCount_ = 0;
+    std::vector<Scope> scopes_;
+    bool tracing_ = false;
+    std::vector<TraceEvent> trace_;
+    std::vector<std::thread::id> threads_;
+
+    void pushFrame(double ms);
+    void traceLocked(const char* name, Clock::time_point start, Clock::time_point end);
+    size_t samplesLocked() const;
+};
+
+// The process-wide profiler PROFILE_SCOPE reports to
+FrameProfiler& profiler();
+
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) : name_(name), start_(FrameProfiler::Clock::now()) {}
+    ~ProfileScope() { profiler().record(name_, start_, FrameProfiler::Clock::now()); }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    const char* name_;
+    FrameProfiler::Clock::time_point start_;
+};
+
+} // namespace Gui
+
+#ifdef CHESS_PROFILER
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+// Times the rest of the enclosing block under a string-literal name
+#define PROFILE_SCOPE(name) ::Gui::ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#endif
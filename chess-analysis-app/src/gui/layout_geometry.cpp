@@ -0,0 +1,68 @@
+#include "layout_geometry.hpp"
+
+namespace Gui {
+namespace Layout {
+
+namespace {
+
+Geometry currentGeometry;
+
+} // namespace
+
+Geometry computeGeometry(int width, int height) {
+    Geometry g;
+    g.screenWidth = std::max(width, 1);
+    g.screenHeight = std::max(height, 1);
+    g.scale = std::min((float)g.screenWidth / DESIGN_WIDTH, (float)g.screenHeight / DESIGN_HEIGHT);
+
+    g.evalBarWidth = g.px(20);
+    g.panelWidth = g.px(320);
+    g.tableWidth = g.px(280);
+    g.tableHeaderHeight = g.px(45);
+    g.tableRowHeight = std::max(g.px(25), 12);
+    g.graphHeight = g.px(100);
+    g.btnWidth = g.px(110);
+    g.btnHeight = g.px(40);
+    g.btnMargin = g.px(20);
+    g.btnPlaybackWidth = g.px(80);
+    g.btnPlaybackHeight = g.px(50);
+    g.btnPasteWidth = g.px(150);
+    g.dialogWidth = g.px(600);
+    g.dialogHeight = g.px(400);
+
+    // Buttons above and below the board, the eval bar and a gap to its
+    // left, a gap and the panel to its right; squares are whole pixels
+    int margin = g.px(80);
+    int byHeight = g.screenHeight - 2 * margin;
+    int byWidth = g.screenWidth - 2 * margin - g.panelWidth;
+    g.squareSize = std::max(std::min(byHeight, byWidth) / 8, 1);
+    g.boardSize = g.squareSize * 8;
+
+    // Spare width goes to both sides
+    int contentWidth = 2 * margin + g.boardSize + g.panelWidth;
+    int left = std::max(0, (g.screenWidth - contentWidth) / 2);
+    g.boardX = left + margin;
+    g.boardY = margin;
+    g.evalBarX = left + g.px(40);
+    g.infoX = g.boardX + g.boardSize + margin;
+
+    // The panel is laid out from its top and bottom; the move table
+    // stretches between them
+    g.tableY = g.px(200);
+    g.btnPasteY = g.px(420);
+    g.summaryY = g.screenHeight - g.px(40);
+    g.graphY = g.summaryY - g.px(10) - g.graphHeight;
+    g.tableHeight = std::max(g.graphY - g.px(10) - g.tableY, g.tableHeaderHeight + g.tableRowHeight);
+    return g;
+}
+
+const Geometry& current() {
+    return currentGeometry;
+}
+
+void setCurrent(const Geometry& g) {
+    currentGeometry = g;
+}
+
+} // namespace Layout
+} // namespace Gui
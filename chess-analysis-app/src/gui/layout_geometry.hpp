@@ -0,0 +1,68 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+
+namespace Gui {
+namespace Layout {
+
+// The layout was designed at this size; every length scales from it
+constexpr int DESIGN_WIDTH = 1280;
+constexpr int DESIGN_HEIGHT = 960;
+constexpr int MIN_WIDTH = 640;
+constexpr int MIN_HEIGHT = 480;
+
+// Positions and sizes in window pixels, computed from the window size. The
+// defaults are the design layout. The board takes what the window allows
+// next to the side panel, and the move table takes the panel's spare height.
+struct Geometry {
+    int screenWidth = DESIGN_WIDTH;
+    int screenHeight = DESIGN_HEIGHT;
+    float scale = 1.0f;         // against the design size
+
+    // Board and eval bar
+    int boardX = 80;
+    int boardY = 80;
+    int boardSize = 800;
+    int squareSize = 100;
+    int evalBarX = 40;
+    int evalBarWidth = 20;
+
+    // Side panel
+    int infoX = 960;
+    int panelWidth = 320;
+    int tableY = 200;
+    int tableWidth = 280;
+    int tableHeight = 600;
+    int tableHeaderHeight = 45;
+    int tableRowHeight = 25;
+    int graphY = 810;
+    int graphHeight = 100;
+    int summaryY = 920;
+
+    // Buttons and dialogs
+    int btnWidth = 110;
+    int btnHeight = 40;
+    int btnMargin = 20;
+    int btnPlaybackWidth = 80;
+    int btnPlaybackHeight = 50;
+    int btnPasteY = 420;
+    int btnPasteWidth = 150;
+    int dialogWidth = 600;
+    int dialogHeight = 400;
+
+    // A design-size length in pixels
+    int px(float v) const { return (int)std::lround(v * scale); }
+    // Font sizes stay readable however small the window gets
+    int font(int size) const { return std::max(10, px((float)size)); }
+    int visibleRows() const { return std::max(1, (tableHeight - tableHeaderHeight) / tableRowHeight); }
+};
+
+Geometry computeGeometry(int width, int height);
+
+// The geometry frames are drawn with. Set by main() on the window thread
+// when the window settles at a new size; read by the draw code.
+const Geometry& current();
+void setCurrent(const Geometry& g);
+
+} // namespace Layout
+} // namespace Gui
@@ -0,0 +1,144 @@
+#include "panel_cache.hpp"
+#include "frame_profiler.hpp"
+#include "layout.hpp"
+#include "render_layer.hpp"
+#include <algorithm>
+
+namespace Gui {
+
+using namespace Layout;
+
+// The default font is ASCII only, so Best gets a star rather than a check mark
+const char* classificationSymbol(Chess::MoveClassification c) {
+    switch(c) {
+        case Chess::MoveClassification::Brilliant:  return "!!";
+        case Chess::MoveClassification::Great:      return "!";
+        case Chess::MoveClassification::Best:       return "*";
+        case Chess::MoveClassification::Excellent:  return "!?"; 
+        case Chess::MoveClassification::Good:       return "";
+        case Chess::MoveClassification::Inaccuracy: return "?!";
+        case Chess::MoveClassification::Mistake:    return "?";
+        case Chess::MoveClassification::Blunder:    return "??";
+        case Chess::MoveClassification::GameEnd:    return "";
+        default:                                    return "";
+    }
+}
+
+Color classificationColor(Chess::MoveClassification c) {
+    switch(c) {
+        case Chess::MoveClassification::Brilliant:  return {0, 200, 255, 255};   
+        case Chess::MoveClassification::Great:      return {90, 140, 230, 255};
+        case Chess::MoveClassification::Best:       return {100, 230, 100, 255}; 
+        case Chess::MoveClassification::Good:       return {180, 230, 120, 255}; 
+        case Chess::MoveClassification::Inaccuracy: return {240, 200, 50, 255};  
+        case Chess::MoveClassification::Mistake:    return {240, 140, 50, 255};  
+        case Chess::MoveClassification::Blunder:    return {220, 50, 50, 255};   
+        case Chess::MoveClassification::GameEnd:    return COLOR_TEXT_DIM;
+        default:                                    return COLOR_TEXT_MAIN;
+    }
+}
+
+void MoveTableText::update(const AppSnapshot& s, int fontSize) {
+    PROFILE_SCOPE("move table text");
+    // Results only annotate the table while a review is shown
+    std::shared_ptr<const std::vector<Chess::MoveReview>> results;
+    if (s.reviewState != ReviewState::IDLE) results = s.review.results;
+
+    if (s.sanMoves != sanMoves_ || fontSize != fontSize_) {
+        sanMoves_ = s.sanMoves;
+        fontSize_ = fontSize;
+        const std::vector<std::string>& sans = *sanMoves_;
+
+        moves_.assign(sans.size(), Move());
+        for (size_t i = 0; i < sans.size(); i++) {
+            moves_[i].san = &sans[i];
+            moves_[i].sanWidth = MeasureText(sans[i].c_str(), fontSize);
+        }
+        // Numbers are kept across games; only new rows are formatted
+        size_t rows = (sans.size() + 1) / 2;
+        while (numbers_.size() < rows) numbers_.push_back(std::to_string(numbers_.size() + 1));
+        numbers_.resize(rows);
+
+        results_ = results;
+        annotate();
+    } else if (results != results_) {
+        results_ = results;
+        annotate();
+    }
+}
+
+void MoveTableText::annotate() {
+    for (size_t i = 0; i < moves_.size(); i++) {
+        Move& m = moves_[i];
+        m.symbol = "";
+        if (!results_ || i >= results_->size() || !(*results_)[i].ready) continue;
+        auto cls = (*results_)[i].classification;
+        m.symbol = classificationSymbol(cls);
+        m.symbolColor = classificationColor(cls);
+    }
+}
+
+void EvalGraph::update(const Chess::ReviewSnapshot& review, Rectangle bounds) {
+    PROFILE_SCOPE("eval graph");
+    if (layer_.id == 0 || layer_.texture.width != (int)bounds.width ||
+        layer_.texture.height != (int)bounds.height) {
+        // Resized: render the same results again at the new size
+        if (layer_.id != 0) UnloadRenderTexture(layer_);
+        layer_ = LoadRenderTexture((int)bounds.width, (int)bounds.height);
+        results_.reset();
+    }
+    if (!review.results || review.results == results_) return;
+    results_ = review.results;
+    render(*results_, bounds);
+}
+
+void EvalGraph::render(const std::vector<Chess::MoveReview>& reviews, Rectangle bounds) {
+    beginLayer(layer_);
+    ClearBackground(COLOR_BG);
+    DrawRectangle(0, 0, (int)bounds.width, (int)bounds.height, Fade(BLACK, 0.3f));
+    float mid_y = bounds.height / 2.0f;
+    DrawLineEx({0, mid_y}, {bounds.width, mid_y}, 1.0f, Fade(WHITE, 0.2f));
+
+    // Bars are at least a pixel wide: when a game has more plies than the
+    // graph has columns, each column shows the mean eval of its plies
+    size_t plies = reviews.size();
+    size_t columns = std::min(plies, (size_t)std::max(1.0f, bounds.width));
+    float x_step = plies == 0 ? 0.0f : bounds.width / (float)plies;
+    for (size_t c = 0; c < columns; ++c) {
+        size_t first = c * plies / columns;
+        size_t last = (c + 1) * plies / columns;
+        float sum = 0.0f;
+        int ready = 0;
+        for (size_t i = first; i < last; ++i) {
+            if (!reviews[i].ready) continue;
+            sum += std::clamp(reviews[i].eval_after, -800.0f, 800.0f);
+            ready++;
+        }
+        if (ready == 0) continue;
+        float eval = sum / ready;
+        float norm = (eval + 800.0f) / 1600.0f; 
+        float bar_height = norm * bounds.height;
+        float y = bounds.height - bar_height;
+
+        Color fill = (eval >= 0) ? WHITE : Fade(WHITE, 0.2f);
+        DrawRectangleRec({first * x_step, y, (last - first) * x_step, bar_height}, fill);
+    }
+    endLayer();
+    plies_ = reviews.size();
+}
+
+void EvalGraph::draw(int currentPly, Rectangle bounds) const {
+    drawLayer(layer_, { bounds.x, bounds.y });
+    if (plies_ == 0) return;
+    float cx = bounds.x + currentPly * (bounds.width / (float)plies_);
+    DrawLineEx({cx, bounds.y}, {cx, bounds.y + bounds.height}, 2.0f, COLOR_HIGHLIGHT);
+}
+
+void EvalGraph::unload() {
+    if (layer_.id != 0) UnloadRenderTexture(layer_);
+    layer_ = {};
+    results_.reset();
+    plies_ = 0;
+}
+
+} // namespace Gui
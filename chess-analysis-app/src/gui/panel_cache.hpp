@@ -0,0 +1,65 @@
+#pragma once
+#include "raylib.h"
+#include "app_model.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Gui {
+
+const char* classificationSymbol(Chess::MoveClassification c);
+Color classificationColor(Chess::MoveClassification c);
+
+// Laid-out text of the move table: row numbers, SAN widths and review
+// symbols. Rebuilt only when the move list or the review results are
+// replaced, so a frame draws the visible rows without measuring anything.
+class MoveTableText {
+public:
+    struct Move {
+        const std::string* san = nullptr;
+        int sanWidth = 0;
+        const char* symbol = "";
+        Color symbolColor = BLANK;
+    };
+
+    // Cheap when nothing changed; call once per frame before drawing
+    void update(const AppSnapshot& s, int fontSize);
+
+    int rows() const { return (int)numbers_.size(); }
+    const std::string& number(int row) const { return numbers_[row]; }
+    // Move at ply index idx, or nullptr past the end of the game
+    const Move* move(int idx) const { return idx < (int)moves_.size() ? &moves_[idx] : nullptr; }
+
+private:
+    std::shared_ptr<const std::vector<std::string>> sanMoves_;
+    std::shared_ptr<const std::vector<Chess::MoveReview>> results_;
+    int fontSize_ = 0;
+    std::vector<std::string> numbers_;
+    std::vector<Move> moves_;
+
+    void annotate();
+};
+
+// The review's eval graph, one bar per ply, rendered into a texture when
+// the results are replaced. A frame draws the texture and the ply marker.
+class EvalGraph {
+public:
+    EvalGraph() = default;
+    EvalGraph(const EvalGraph&) = delete;
+    EvalGraph& operator=(const EvalGraph&) = delete;
+
+    // Re-renders if the results or the size changed; call outside BeginDrawing
+    void update(const Chess::ReviewSnapshot& review, Rectangle bounds);
+    void draw(int currentPly, Rectangle bounds) const;
+    // Needs the window still open
+    void unload();
+
+private:
+    RenderTexture2D layer_ = {};
+    std::shared_ptr<const std::vector<Chess::MoveReview>> results_;
+    size_t plies_ = 0;
+
+    void render(const std::vector<Chess::MoveReview>& reviews, Rectangle bounds);
+};
+
+} // namespace Gui
@@ -0,0 +1,124 @@
+#include "piece_atlas.hpp"
+#include <algorithm>
+#include <iterator>
+
+namespace Gui {
+
+namespace {
+
+struct PieceFile {
+    Chess::Piece piece;
+    const char* name;
+};
+
+const PieceFile PIECE_FILES[] = {
+    { Chess::W_PAWN, "w_pawn" },
+    { Chess::W_KNIGHT, "w_knight" },
+    { Chess::W_BISHOP, "w_bishop" },
+    { Chess::W_ROOK, "w_rook" },
+    { Chess::W_QUEEN, "w_queen" },
+    { Chess::W_KING, "w_king" },
+    { Chess::B_PAWN, "b_pawn" },
+    { Chess::B_KNIGHT, "b_knight" },
+    { Chess::B_BISHOP, "b_bishop" },
+    { Chess::B_ROOK, "b_rook" },
+    { Chess::B_QUEEN, "b_queen" },
+    { Chess::B_KING, "b_king" },
+};
+
+// Image heights on disk, each set in its own directory ("256h/")
+const int SPRITE_SIZES[] = { 128, 256, 512, 1024 };
+
+constexpr int ATLAS_COLUMNS = 6;
+// Transparent border around each image, so smaller mip levels do not pull
+// in the neighbouring piece
+constexpr int CELL_PADDING = 8;
+
+} // namespace
+
+int PieceAtlas::spriteSizeFor(int squareSize) {
+    // Pieces fill at most 85% of a square; the next size up is only ever
+    // scaled down, which the mipmaps keep smooth
+    int needed = squareSize * 85 / 100;
+    for (int size : SPRITE_SIZES) {
+        if (size >= needed) return size;
+    }
+    return SPRITE_SIZES[std::size(SPRITE_SIZES) - 1];
+}
+
+bool PieceAtlas::decode(const std::string& dir, int spriteSize) {
+    if (decoded_.data != nullptr) UnloadImage(decoded_);
+    decoded_ = {};
+
+    std::string px = std::to_string(spriteSize);
+    Image images[12];
+    int cell = 0;
+    bool ok = true;
+    for (int i = 0; i < 12; i++) {
+        std::string path = dir + px + "h/" + PIECE_FILES[i].name + "_png_" + px + "px.png";
+        images[i] = LoadImage(path.c_str());
+        if (images[i].data == nullptr) ok = false;
+        cell = std::max({ cell, images[i].width, images[i].height });
+    }
+    cell += 2 * CELL_PADDING;
+
+    if (ok) {
+        Image atlas = GenImageColor(ATLAS_COLUMNS * cell, 2 * cell, BLANK);
+        for (int i = 0; i < 12; i++) {
+            const Image& img = images[i];
+            // Centered in its cell: white pieces on the top row, black below
+            float x = (float)((i % ATLAS_COLUMNS) * cell + (cell - img.width) / 2);
+            float y = (float)((i / ATLAS_COLUMNS) * cell + (cell - img.height) / 2);
+            Rectangle src = { 0, 0, (float)img.width, (float)img.height };
+            Rectangle dst = { x, y, (float)img.width, (float)img.height };
+            ImageDraw(&atlas, img, src, dst, WHITE);
+            decodedCells_[PIECE_FILES[i].piece] = dst;
+        }
+        decoded_ = atlas;
+        decodedSize_ = spriteSize;
+    }
+
+    for (int i = 0; i < 12; i++) {
+        if (images[i].data != nullptr) UnloadImage(images[i]);
+    }
+    return ok;
+}
+
+bool PieceAtlas::upload() {
+    if (decoded_.data == nullptr) return false;
+    if (texture_.id != 0) UnloadTexture(texture_);
+    texture_ = LoadTextureFromImage(decoded_);
+    UnloadImage(decoded_);
+    decoded_ = {};
+    std::copy(std::begin(decodedCells_), std::end(decodedCells_), std::begin(cells_));
+    spriteSize_ = decodedSize_;
+    GenTextureMipmaps(&texture_);
+    SetTextureFilter(texture_, TEXTURE_FILTER_TRILINEAR);
+    return ready();
+}
+
+void PieceAtlas::unload() {
+    if (texture_.id != 0) UnloadTexture(texture_);
+    texture_ = {};
+    if (decoded_.data != nullptr) UnloadImage(decoded_);
+    decoded_ = {};
+    spriteSize_ = 0;
+}
+
+void PieceAtlas::draw(Chess::Piece p, Vector2 pos, float squareSize) const {
+    if (!ready() || p < 0 || p >= 14 || cells_[p].width == 0) return;
+    float pieceScale = (p == Chess::W_PAWN || p == Chess::B_PAWN) ? 0.70f : 0.85f;
+    const Rectangle& src = cells_[p];
+
+    float scale = (squareSize * pieceScale) / std::max(src.width, src.height);
+    float drawnW = src.width * scale;
+    float drawnH = src.height * scale;
+
+    float offsetX = (squareSize - drawnW) / 2.0f;
+    float offsetY = (squareSize - drawnH) / 2.0f;
+
+    Rectangle dst = { pos.x + offsetX, pos.y + offsetY, drawnW, drawnH };
+    DrawTexturePro(texture_, src, dst, { 0, 0 }, 0.0f, WHITE);
+}
+
+} // namespace Gui
@@ -0,0 +1,48 @@
+#pragma once
+#include "raylib.h"
+#include "../core/types.hpp"
+#include <string>
+
+namespace Gui {
+
+// The twelve piece images packed into one mipmapped texture with trilinear
+// filtering. Every piece is drawn from the same texture, so a whole board
+// goes out as one batch and downscaled pieces stay smooth.
+class PieceAtlas {
+public:
+    PieceAtlas() = default;
+    PieceAtlas(const PieceAtlas&) = delete;
+    PieceAtlas& operator=(const PieceAtlas&) = delete;
+
+    // Smallest image size on disk that covers a square this many pixels wide
+    static int spriteSizeFor(int squareSize);
+
+    // Reads the piece PNGs of one size from dir and packs them into an
+    // image; false if any is missing. CPU only, so it can run on a worker
+    // thread while the window draws, even from an atlas already uploaded,
+    // as long as no other decode or upload runs meanwhile.
+    bool decode(const std::string& dir, int spriteSize);
+    // Window thread: turns the decoded image into the texture, replacing
+    // the one drawn so far
+    bool upload();
+    bool load(const std::string& dir, int spriteSize) { return decode(dir, spriteSize) && upload(); }
+    // Needs the window still open
+    void unload();
+    bool ready() const { return texture_.id != 0; }
+    // Image size of the uploaded pieces, 0 before the first upload
+    int spriteSize() const { return spriteSize_; }
+
+    // Piece centered in the square whose top-left corner is pos
+    void draw(Chess::Piece p, Vector2 pos, float squareSize) const;
+
+private:
+    Texture2D texture_ = {};
+    Rectangle cells_[14] = {};   // each piece's image within the atlas
+    int spriteSize_ = 0;
+    // Between decode() and upload()
+    Image decoded_ = {};
+    Rectangle decodedCells_[14] = {};
+    int decodedSize_ = 0;
+};
+
+} // namespace Gui
@@ -0,0 +1,27 @@
+#pragma once
+#include "raylib.h"
+#include "rlgl.h"
+
+namespace Gui {
+
+// Cached layers are drawn once into a RenderTexture2D and composited each
+// frame. Alpha in a layer adds up as it does on screen, so what is drawn
+// over an opaque background stays opaque and composites without fringes.
+inline void beginLayer(const RenderTexture2D& layer) {
+    BeginTextureMode(layer);
+    rlSetBlendFactorsSeparate(RL_SRC_ALPHA, RL_ONE_MINUS_SRC_ALPHA, RL_ONE, RL_ONE_MINUS_SRC_ALPHA, RL_FUNC_ADD, RL_FUNC_ADD);
+    BeginBlendMode(BLEND_CUSTOM_SEPARATE);
+}
+
+inline void endLayer() {
+    EndBlendMode();
+    EndTextureMode();
+}
+
+// Render textures are stored bottom-up; a negative source height flips them
+inline void drawLayer(const RenderTexture2D& layer, Vector2 pos) {
+    Rectangle src = { 0, 0, (float)layer.texture.width, -(float)layer.texture.height };
+    DrawTextureRec(layer.texture, src, pos, WHITE);
+}
+
+} // namespace Gui
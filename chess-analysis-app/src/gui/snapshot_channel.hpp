@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+
+namespace Gui {
+
+// Latest-value channel between producer threads and one consumer, built on
+// a triple buffer: the producer fills a back slot and swaps it with the
+// middle one; the consumer swaps the middle slot into the front when it is
+// newer. Neither side ever waits for the other, and nothing is allocated
+// after construction. Values skipped by a slow consumer are dropped.
+//
+// The consumer side (refresh/latest) belongs to one thread. Producers may
+// run on several threads; they serialize on a mutex the consumer never takes.
+template <typename T>
+class SnapshotChannel {
+public:
+    // Fills the back slot in place and publishes it
+    template <typename Fill>
+    void publish(Fill&& fill) {
+        std::lock_guard<std::mutex> lock(writerMutex_);
+        fill(slots_[back_]);
+        back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Consumer: takes the newest published value, if any; true if it changed
+    bool refresh() {
+        if (!(middle_.load(std::memory_order_acquire) & FRESH)) return false;
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    // Consumer: the value taken by the last refresh()
+    const T& latest() const { return slots_[front_]; }
+
+private:
+    static constexpr unsigned INDEX = 3;
+    static constexpr unsigned FRESH = 4;
+
+    T slots_[3] = {};
+    std::atomic<unsigned> middle_{1};
+    unsigned back_ = 0;     // producers only
+    unsigned front_ = 2;    // consumer only
+    std::mutex writerMutex_;
+};
+
+} // namespace Gui
@@ -1,119 +1,140 @@
 #include "raylib.h"
 #include "core/board.hpp"
 #include "core/game_record.hpp"
+#include "core/pgn.hpp"
 #include "engine/stockfish.hpp"
+#include "engine/analysis_cache.hpp"
+#include "engine/analysis_scheduler.hpp"
+#include "engine/engine_supervisor.hpp"
+#include "engine/engine_pool.hpp"
 #include "engine/game_reviewer.hpp"
+#include "gui/app_model.hpp"
+#include "gui/board_renderer.hpp"
+#include "gui/piece_atlas.hpp"
+#include "gui/panel_cache.hpp"
+#include "gui/frame_profiler.hpp"
 #include "gui/layout.hpp"
 #include <iostream>
 #include <string>
 #include <sstream>
 #include <algorithm>
-#include <mutex>
+#include <chrono>
+#include <future>
+#include <vector>
 
 // Forward declaration of the platform-specific clipboard function
 std::string GetClipboardTextFallback();
 
-enum class ReviewState { IDLE, REVIEWING, REVIEW_DONE };
-
 using namespace Gui::Layout;
+using Gui::ReviewState;
 
-const char* classificationSymbol(Chess::MoveClassification c) {
-    switch(c) {
-        case Chess::MoveClassification::Brilliant:  return "!!";
-        case Chess::MoveClassification::Best:       return "!";
-        case Chess::MoveClassification::Excellent:  return "!?"; 
-        case Chess::MoveClassification::Good:       return "";
-        case Chess::MoveClassification::Inaccuracy: return "?!";
-        case Chess::MoveClassification::Mistake:    return "?";
-        case Chess::MoveClassification::Blunder:    return "??";
-        case Chess::MoveClassification::GameEnd:    return "";
-        default:                                    return "";
-    }
-}
+// Frames are drawn at ACTIVE_FPS only while something changes; otherwise
+// input is polled IDLE_POLL_HZ times a second and nothing is drawn
+constexpr int ACTIVE_FPS = 60;
+constexpr double IDLE_POLL_HZ = 30.0;
+// After an idle stretch the frame time spans the whole wait
+constexpr float MAX_FRAME_DT = 1.0f / 20.0f;
+
+constexpr Color ARROW_COLOR = { 72, 150, 235, 255 };
+
+// A new window size takes effect once the window has held it this long, so
+// dragging an edge lays out and rebuilds the cached layers once
+constexpr double LAYOUT_SETTLE_SECONDS = 0.15;
 
-Color classificationColor(Chess::MoveClassification c) {
-    switch(c) {
-        case Chess::MoveClassification::Brilliant:  return {0, 200, 255, 255};   
-        case Chess::MoveClassification::Best:       return {100, 230, 100, 255}; 
-        case Chess::MoveClassification::Good:       return {180, 230, 120, 255}; 
-        case Chess::MoveClassification::Inaccuracy: return {240, 200, 50, 255};  
-        case Chess::MoveClassification::Mistake:    return {240, 140, 50, 255};  
-        case Chess::MoveClassification::Blunder:    return {220, 50, 50, 255};   
-        case Chess::MoveClassification::GameEnd:    return COLOR_TEXT_DIM;
-        default:                                    return COLOR_TEXT_MAIN;
+// The engine has this long to answer the UCI handshake
+constexpr int ENGINE_HANDSHAKE_TIMEOUT_MS = 10000;
+
+// Startup milestones, in milliseconds since launch, each printed once
+class StartupMetrics {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit StartupMetrics(Clock::time_point launched) : launched(launched) {}
+
+    void mark(bool& done, const char* milestone) {
+        if (done) return;
+        done = true;
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - launched).count();
+        std::cout << "Startup: " << milestone << " after " << ms << " ms" << std::endl;
     }
+
+    bool firstFrame = false;
+    bool piecesReady = false;
+    bool engineReady = false;
+    bool firstEval = false;
+
+private:
+    Clock::time_point launched;
+};
+
+// Screen rectangles shared by input handling and drawing, in the current
+// layout
+Rectangle topButtonRect(int i) {
+    const Geometry& g = current();
+    // Flip, Reload, Review; the last one is wider
+    float x = (float)(g.boardX + i * (g.btnWidth + g.btnMargin));
+    return { x, (float)g.btnMargin, (float)(g.btnWidth + (i == 2 ? g.px(20) : 0)), (float)g.btnHeight };
 }
 
-void drawEvalGraph(const std::vector<Chess::MoveReview>& reviews, int current_ply, Rectangle bounds) {
-    DrawRectangleRec(bounds, Fade(BLACK, 0.3f));
-    float mid_y = bounds.y + bounds.height / 2.0f;
-    DrawLineEx({bounds.x, mid_y}, {bounds.x + bounds.width, mid_y}, 1.0f, Fade(WHITE, 0.2f));
+Rectangle playbackButtonRect(int i) {
+    const Geometry& g = current();
+    // Centered under the board
+    int gap = g.px(10);
+    int startX = g.boardX + (g.boardSize - (5 * g.btnPlaybackWidth + 4 * gap)) / 2;
+    int btnY = g.boardY + g.boardSize + g.btnMargin;
+    return { (float)(startX + i * (g.btnPlaybackWidth + gap)), (float)btnY, (float)g.btnPlaybackWidth, (float)g.btnPlaybackHeight };
+}
 
-    if (reviews.empty()) return;
+Rectangle pasteButtonRect() {
+    const Geometry& g = current();
+    return { (float)g.infoX, (float)g.btnPasteY, (float)g.btnPasteWidth, (float)g.btnHeight };
+}
 
-    float x_step = bounds.width / (float)reviews.size();
+Rectangle moveTableRect() {
+    const Geometry& g = current();
+    return { (float)g.infoX, (float)g.tableY, (float)g.tableWidth, (float)g.tableHeight };
+}
 
-    for (size_t i = 0; i < reviews.size(); ++i) {
-        float eval = reviews[i].eval_after; 
-        eval = std::clamp(eval, -800.0f, 800.0f);
-        float norm = (eval + 800.0f) / 1600.0f; 
-        float bar_height = norm * bounds.height;
-        float y = bounds.y + bounds.height - bar_height;
+Rectangle evalGraphRect() {
+    const Geometry& g = current();
+    return { (float)g.infoX, (float)g.graphY, (float)g.tableWidth, (float)g.graphHeight };
+}
 
-        Color fill = (eval >= 0) ? WHITE : Fade(WHITE, 0.2f);
-        DrawRectangle(bounds.x + i * x_step, y, x_step, bar_height, fill);
-    }
-    float cx = bounds.x + current_ply * x_step;
-    DrawLineEx({cx, bounds.y}, {cx, bounds.y + bounds.height}, 2.0f, COLOR_HIGHLIGHT);
+Rectangle dialogRect() {
+    const Geometry& g = current();
+    return { (float)((g.screenWidth - g.dialogWidth) / 2), (float)((g.screenHeight - g.dialogHeight) / 2),
+             (float)g.dialogWidth, (float)g.dialogHeight };
 }
 
-struct AnimState {
-    bool active = false;
-    Chess::Piece piece;
-    Vector2 startPos;
-    Vector2 endPos;
-    float progress; // 0.0 to 1.0
-    float speed = 8.0f; 
-};
+Rectangle dialogCloseRect() {
+    const Geometry& g = current();
+    Rectangle d = dialogRect();
+    return { d.x + d.width - g.px(40), d.y + g.px(10), (float)g.px(30), (float)g.px(30) };
+}
 
-// Helper to parse PGN and populate record
-void LoadPgnToRecord(const std::string& pgn, Chess::Board& board, Chess::GameRecord& record) {
-    board.loadPgn(pgn);
-    std::vector<Chess::Move> moves = board.getHistoryMoves();
-    record.reset();
-    board.reset();
-    for (const auto& m : moves) {
-        std::string san = board.moveToSan(m);
-        record.addMove(m, san);
-        board.makeMove(m);
-    }
+Rectangle dialogAnalyzeRect() {
+    const Geometry& g = current();
+    Rectangle d = dialogRect();
+    return { d.x + (d.width - g.px(120)) / 2, d.y + d.height - g.px(60), (float)g.px(120), (float)g.btnHeight };
 }
 
-float GetEvalFill(const std::string& evalStr) {
-    if (evalStr == "N/A" || evalStr.empty()) return 0.5f;
-    
-    if (evalStr.find("M") != std::string::npos || evalStr.find("mate") != std::string::npos) {
-        if (evalStr.find("-") != std::string::npos) return 0.0f;
-        return 1.0f;
-    }
-    
-    try {
-        float val = std::stof(evalStr);
-        if (val > 10.0f) val = 10.0f;
-        if (val < -10.0f) val = -10.0f;
-        return 0.5f + (val / 20.0f);
-    } catch (...) {
-        return 0.5f;
-    }
+float GetEvalFill(const Gui::AnalysisSnapshot& a) {
+    if (a.sequence == 0) return 0.5f;
+    // Mate in 0 means the side to move is mated
+    if (a.isMate) return a.score > 0 ? 1.0f : 0.0f;
+    float val = std::clamp(a.score / 100.0f, -10.0f, 10.0f);
+    return 0.5f + (val / 20.0f);
 }
 
-void DrawEvalBar(const std::string& evalStr, bool isFlipped) {
-    float fill = GetEvalFill(evalStr);
+void DrawEvalBar(const Gui::AnalysisSnapshot& analysis, bool isFlipped) {
+    PROFILE_SCOPE("draw eval bar");
+    const Geometry& g = current();
+    float fill = GetEvalFill(analysis);
     
-    int barX = EVAL_BAR_OFFSET_X;
-    int barY = BOARD_OFFSET_Y;
-    int barW = EVAL_BAR_WIDTH;
-    int barH = BOARD_SIZE;
+    int barX = g.evalBarX;
+    int barY = g.boardY;
+    int barW = g.evalBarWidth;
+    int barH = g.boardSize;
 
     // Black background (equivalent to Black advantage)
     DrawRectangle(barX, barY, barW, barH, Fade(BLACK, 0.8f));
@@ -129,238 +150,168 @@ void DrawEvalBar(const std::string& evalStr, bool isFlipped) {
     DrawRectangleLines(barX, barY, barW, barH, COLOR_DARK);
 }
 
-void DrawBoardBackground(int selectedSq, bool isFlipped) {
-    for (int r = 0; r < 8; r++) {
-        for (int f = 0; f < 8; f++) {
-            Color c = ((r + f) % 2 == 0) ? COLOR_DARK : COLOR_LIGHT;
-            int drawR = isFlipped ? r : (7 - r);
-            int drawF = isFlipped ? (7 - f) : f;
-            int drawX = BOARD_OFFSET_X + drawF * SQUARE_SIZE;
-            int drawY = BOARD_OFFSET_Y + drawR * SQUARE_SIZE;
-            DrawRectangle(drawX, drawY, SQUARE_SIZE, SQUARE_SIZE, c);
-        }
-    }
-    
-    if (selectedSq != -1) {
-        int r = selectedSq / 8;
-        int f = selectedSq % 8;
-        int drawR = isFlipped ? r : (7 - r);
-        int drawF = isFlipped ? (7 - f) : f;
-        DrawRectangle(BOARD_OFFSET_X + drawF * SQUARE_SIZE, BOARD_OFFSET_Y + drawR * SQUARE_SIZE, SQUARE_SIZE, SQUARE_SIZE, COLOR_SELECTED);
+constexpr int MOVE_FONT_SIZE = 18;
+
+// The engine's lines under the eval: score, then the moves in SAN, cut off
+// at the panel edge. Text appears once the formatter has caught up.
+void DrawAnalysisLines(const Gui::AppSnapshot& s) {
+    PROFILE_SCOPE("draw analysis lines");
+    if (!s.analysisCurrent) return;
+    const Gui::AnalysisSnapshot& a = s.analysis;
+    bool textReady = s.pvText.requestId == a.requestId;
+    const Geometry& g = current();
+
+    int lineY = g.px(100);
+    int lineHeight = g.px(22);
+    int fontSize = g.font(18);
+    BeginScissorMode(g.infoX, lineY, g.panelWidth - g.px(20), Gui::AnalysisSnapshot::MAX_LINES * lineHeight);
+    for (int i = 0; i < a.lineCount; i++) {
+        const Gui::AnalysisLine& line = a.lines[i];
+        if (line.pvLength == 0) continue;
+        const char* score = line.isMate ? TextFormat("#%d", line.score) : TextFormat("%+.2f", line.score / 100.0f);
+        int y = lineY + i * lineHeight;
+        DrawText(score, g.infoX, y, fontSize, i == 0 ? COLOR_TEXT_MAIN : COLOR_TEXT_DIM);
+        if (textReady && i < s.pvText.lineCount) DrawText(s.pvText.lines[i], g.infoX + g.px(60), y, fontSize, COLOR_TEXT_DIM);
     }
+    EndScissorMode();
 }
 
-void DrawPieces(const Chess::Board& board, const AnimState& anim, bool isFlipped, Texture2D pieceTextures[14]) {
-    for (int i = 0; i < 64; i++) {
-        Chess::Piece p = board.getPiece(i);
-        if (p == Chess::NO_PIECE) continue;
-        
-        int r = i / 8;
-        int f = i % 8;
-        
-        if (anim.active) {
-             int destF = (int)((anim.endPos.x - BOARD_OFFSET_X)/SQUARE_SIZE);
-             int destR = (int)((anim.endPos.y - BOARD_OFFSET_Y)/SQUARE_SIZE);
-             int realF = isFlipped ? (7 - destF) : destF;
-             int realR = isFlipped ? destR : (7 - destR);
-             int destSq = realR * 8 + realF;
-             if (i == destSq) continue; 
-        }
-
-        int drawR = isFlipped ? r : (7 - r);
-        int drawF = isFlipped ? (7 - f) : f;
-        int drawX = BOARD_OFFSET_X + drawF * SQUARE_SIZE;
-        int drawY = BOARD_OFFSET_Y + drawR * SQUARE_SIZE;
-        
-        // Draw Texture
-        if (p >= 0 && p < 14 && pieceTextures[p].id != 0) {
-            float pieceScale = (p == Chess::W_PAWN || p == Chess::B_PAWN) ? 0.70f : 0.85f;
-            float texW = (float)pieceTextures[p].width;
-            float texH = (float)pieceTextures[p].height;
-            
-            float scale = ((float)SQUARE_SIZE * pieceScale) / std::max(texW, texH);
-            float drawnW = texW * scale;
-            float drawnH = texH * scale;
-
-            float offsetX = ((float)SQUARE_SIZE - drawnW) / 2.0f;
-            float offsetY = ((float)SQUARE_SIZE - drawnH) / 2.0f;
-
-            DrawTextureEx(pieceTextures[p], {(float)drawX + offsetX, (float)drawY + offsetY}, 0.0f, scale, WHITE);
-        }
+void DrawSidePanel(const Gui::AppSnapshot& s, const Gui::MoveTableText& table, const Gui::EvalGraph& graph, Vector2 mousePos) {
+    PROFILE_SCOPE("draw side panel");
+    const Geometry& g = current();
+    int infoX = g.infoX;
+    const Chess::ReviewSnapshot& review = s.review;
+    ReviewState reviewState = s.reviewState;
+
+    DrawText("Analysis", infoX, g.px(20), g.font(30), COLOR_TEXT_MAIN);
+    int statusY = g.px(52);
+    int statusSize = g.font(14);
+    switch (s.engineStatus) {
+        case Gui::EngineStatus::Starting:
+            DrawText("Engine: starting...", infoX, statusY, statusSize, COLOR_TEXT_DIM);
+            break;
+        case Gui::EngineStatus::Ready:
+            DrawText(TextFormat("Engine: %s", s.engineMessage->c_str()), infoX, statusY, statusSize, COLOR_TEXT_DIM);
+            break;
+        case Gui::EngineStatus::Failed:
+            DrawText(TextFormat("Engine: %s", s.engineMessage->c_str()), infoX, statusY, statusSize, RED);
+            break;
     }
+    DrawText(TextFormat("Eval: %s", s.analysis.eval), infoX, g.px(70), g.font(20), COLOR_TEXT_MAIN);
+    DrawText(s.turn == Chess::White ? "White to Move" : "Black to Move", infoX + g.px(150), g.px(72), g.font(18), COLOR_TEXT_DIM);
+    DrawAnalysisLines(s);
     
-    if (anim.active) {
-        Vector2 pos;
-        pos.x = anim.startPos.x + (anim.endPos.x - anim.startPos.x) * anim.progress;
-        pos.y = anim.startPos.y + (anim.endPos.y - anim.startPos.y) * anim.progress;
-        
-        if (anim.piece >= 0 && anim.piece < 14 && pieceTextures[anim.piece].id != 0) {
-            float pieceScale = (anim.piece == Chess::W_PAWN || anim.piece == Chess::B_PAWN) ? 0.70f : 0.85f;
-            float texW = (float)pieceTextures[anim.piece].width;
-            float texH = (float)pieceTextures[anim.piece].height;
-
-            float scale = ((float)SQUARE_SIZE * pieceScale) / std::max(texW, texH);
-            float drawnW = texW * scale;
-            float drawnH = texH * scale;
-
-            float offsetX = ((float)SQUARE_SIZE - drawnW) / 2.0f;
-            float offsetY = ((float)SQUARE_SIZE - drawnH) / 2.0f;
-
-            pos.x += offsetX;
-            pos.y += offsetY;
-            DrawTextureEx(pieceTextures[anim.piece], pos, 0.0f, scale, WHITE);
-        }
-    }
-}
-
-void DrawSidePanel(bool showDialog, bool isAnalysisActive, int& scroll, const Chess::GameRecord& gameRecord, const std::string& currentEval, const std::string& bestMoveSan, std::mutex& evalMutex, Chess::Side turn, Vector2 mousePos, ReviewState reviewState, const Chess::GameReviewer& gameReviewer) {
-    int infoX = INFO_X;
-    
-    std::string displayEval, displayBestMove;
-    {
-        std::lock_guard<std::mutex> lock(evalMutex);
-        displayEval = currentEval;
-        displayBestMove = bestMoveSan;
-    }
-
-    DrawText("Analysis", infoX, 20, 30, COLOR_TEXT_MAIN);
-    DrawText(("Eval: " + displayEval).c_str(), infoX, 70, 20, COLOR_TEXT_MAIN);
-    DrawText(("Best: " + displayBestMove).c_str(), infoX, 100, 20, COLOR_TEXT_MAIN);
-    
-    if (turn == Chess::White) DrawText("White to Move", infoX, 150, 20, COLOR_TEXT_DIM);
-    else DrawText("Black to Move", infoX, 150, 20, COLOR_TEXT_DIM);
-    
-    if (!isAnalysisActive) {
-        if (!showDialog) {
-            int pasteButtonY = BTN_PASTE_Y;
-            bool mouseOverPaste = CheckCollisionPointRec(mousePos, { (float)infoX, (float)pasteButtonY, (float)BTN_PASTE_W, (float)BTN_HEIGHT });
-            DrawRectangle(infoX, pasteButtonY, BTN_PASTE_W, BTN_HEIGHT, mouseOverPaste ? COLOR_SELECTED : COLOR_DARK);
-            DrawText("Paste PGN", infoX + 25, pasteButtonY + 10, 20, COLOR_BG);
+    if (!s.analysisActive) {
+        if (!s.showPasteDialog) {
+            Rectangle btn = pasteButtonRect();
+            bool mouseOverPaste = CheckCollisionPointRec(mousePos, btn);
+            DrawRectangleRec(btn, mouseOverPaste ? COLOR_SELECTED : COLOR_DARK);
+            DrawText("Paste PGN", infoX + g.px(25), (int)btn.y + g.px(10), g.font(20), COLOR_BG);
         }
     } else {
         // Draw Move Table
-        int tableY = TABLE_Y;
-        int tableWidth = TABLE_WIDTH;
-        int tableHeight = TABLE_HEIGHT;
-        
-        bool mouseOverTable = CheckCollisionPointRec(mousePos, { (float)infoX, (float)tableY, (float)tableWidth, (float)tableHeight });
-        if (mouseOverTable) {
-            float wheel = GetMouseWheelMove();
-            if (wheel > 0) scroll -= 3;
-            if (wheel < 0) scroll += 3;
-        }
+        int tableY = g.tableY;
+        int tableWidth = g.tableWidth;
+        int tableHeight = g.tableHeight;
+        int moveFont = g.font(MOVE_FONT_SIZE);
 
         DrawRectangle(infoX, tableY, tableWidth, tableHeight, Fade(BLACK, 0.3f));
         
-        DrawText("White", infoX + 40, tableY + 10, 20, COLOR_TEXT_MAIN);
-        DrawText("Black", infoX + tableWidth / 2 + 40, tableY + 10, 20, COLOR_TEXT_MAIN);
+        DrawText("White", infoX + g.px(40), tableY + g.px(10), g.font(20), COLOR_TEXT_MAIN);
+        DrawText("Black", infoX + tableWidth / 2 + g.px(40), tableY + g.px(10), g.font(20), COLOR_TEXT_MAIN);
         DrawLine(infoX + tableWidth / 2, tableY, infoX + tableWidth / 2, tableY + tableHeight, Fade(COLOR_TEXT_DIM, 0.5f));
-        DrawLine(infoX, tableY + 35, infoX + tableWidth, tableY + 35, Fade(COLOR_TEXT_DIM, 0.5f));
-        
-        int itemsY = tableY + 45;
-        int rowHeight = 25;
-        int visibleRows = (tableHeight - 45) / rowHeight;
-        int numRows = (gameRecord.sanMoves.size() + 1) / 2;
+        DrawLine(infoX, tableY + g.px(35), infoX + tableWidth, tableY + g.px(35), Fade(COLOR_TEXT_DIM, 0.5f));
         
-        if (numRows > visibleRows) {
-            // Only auto-scroll if mouse isn't scrolling table manually
-            if (!mouseOverTable) {
-                int currentRow = gameRecord.currentIndex / 2;
-                if (currentRow > scroll + visibleRows - 1) scroll = currentRow - visibleRows + 1;
-                if (currentRow < scroll) scroll = currentRow;
-            }
-            if (scroll < 0) scroll = 0;
-            if (scroll > numRows - visibleRows) scroll = numRows - visibleRows;
-        } else {
-            scroll = 0;
-        }
+        int itemsY = tableY + g.tableHeaderHeight;
+        int rowHeight = g.tableRowHeight;
+        int visibleRows = g.visibleRows();
+        int numRows = table.rows();
+        int scroll = s.tableScroll;
         
         auto drawAnnotatedMove = [&](int idx, int drawX, int drawY) {
-            if (idx < gameRecord.sanMoves.size()) {
-                std::string text = gameRecord.sanMoves[idx];
-                DrawText(text.c_str(), drawX, drawY, 18, COLOR_TEXT_MAIN);
-                if (reviewState == ReviewState::REVIEW_DONE) {
-                    const auto& results = gameReviewer.getResults();
-                    if (idx < results.size()) {
-                        auto cls = results[idx].classification;
-                        const char* sym = classificationSymbol(cls);
-                        if (sym[0] != '\0') {
-                            int textW = MeasureText(text.c_str(), 18);
-                            DrawText(sym, drawX + textW + 2, drawY, 16, classificationColor(cls));
-                        }
-                    }
-                }
-            }
+            const Gui::MoveTableText::Move* m = table.move(idx);
+            if (!m) return;
+            DrawText(m->san->c_str(), drawX, drawY, moveFont, COLOR_TEXT_MAIN);
+            if (m->symbol[0] != '\0') DrawText(m->symbol, drawX + m->sanWidth + 2, drawY, g.font(16), m->symbolColor);
         };
 
         for (int i = 0; i < visibleRows; i++) {
             int rowIndex = scroll + i;
             if (rowIndex >= numRows) break;
             
-            int moveNum = rowIndex + 1;
             int whiteMoveIdx = rowIndex * 2;
             int blackMoveIdx = rowIndex * 2 + 1;
+            int rowY = itemsY + i * rowHeight;
             
-            DrawText(std::to_string(moveNum).c_str(), infoX + 5, itemsY + i * rowHeight, 18, COLOR_TEXT_DIM);
+            DrawText(table.number(rowIndex).c_str(), infoX + g.px(5), rowY, moveFont, COLOR_TEXT_DIM);
             
-            if (whiteMoveIdx == gameRecord.currentIndex - 1) DrawRectangle(infoX + 30, itemsY + i * rowHeight - 2, tableWidth / 2 - 30, rowHeight, Fade(COLOR_SELECTED, 0.5f));
-            if (blackMoveIdx == gameRecord.currentIndex - 1) DrawRectangle(infoX + tableWidth / 2 + 5, itemsY + i * rowHeight - 2, tableWidth / 2 - 10, rowHeight, Fade(COLOR_SELECTED, 0.5f));
+            if (whiteMoveIdx == s.currentIndex - 1) DrawRectangle(infoX + g.px(30), rowY - 2, tableWidth / 2 - g.px(30), rowHeight, Fade(COLOR_SELECTED, 0.5f));
+            if (blackMoveIdx == s.currentIndex - 1) DrawRectangle(infoX + tableWidth / 2 + g.px(5), rowY - 2, tableWidth / 2 - g.px(10), rowHeight, Fade(COLOR_SELECTED, 0.5f));
 
-            drawAnnotatedMove(whiteMoveIdx, infoX + 40, itemsY + i * rowHeight);
-            drawAnnotatedMove(blackMoveIdx, infoX + tableWidth / 2 + 30, itemsY + i * rowHeight);
+            drawAnnotatedMove(whiteMoveIdx, infoX + g.px(40), rowY);
+            drawAnnotatedMove(blackMoveIdx, infoX + tableWidth / 2 + g.px(30), rowY);
         }
 
+        // The graph fills in while the review runs
+        if (reviewState != ReviewState::IDLE) graph.draw(s.currentIndex, evalGraphRect());
+        int summaryY = g.summaryY;
         if (reviewState == ReviewState::REVIEW_DONE) {
-            drawEvalGraph(gameReviewer.getResults(), gameRecord.currentIndex, { (float)infoX, (float)(tableY + tableHeight + 10), (float)tableWidth, 100 });
-            auto wSum = Chess::computeSummary(gameReviewer.getResults(), true);
-            auto bSum = Chess::computeSummary(gameReviewer.getResults(), false);
-            DrawText(TextFormat("W Acc: %.1f%%  B Acc: %.1f%%", wSum.accuracy, bSum.accuracy), infoX, 920, 18, COLOR_TEXT_MAIN);
-            DrawText(TextFormat("W Err: %d?? %d? %d?!", wSum.blunders, wSum.mistakes, wSum.inaccuracies), infoX, 940, 14, COLOR_TEXT_DIM);
-            DrawText(TextFormat("B Err: %d?? %d? %d?!", bSum.blunders, bSum.mistakes, bSum.inaccuracies), infoX + 150, 940, 14, COLOR_TEXT_DIM);
+            auto wSum = review.report->side(true).summary();
+            auto bSum = review.report->side(false).summary();
+            int errY = summaryY + g.px(20);
+            DrawText(TextFormat("W Acc: %.1f%%  B Acc: %.1f%%", wSum.accuracy, bSum.accuracy), infoX, summaryY, g.font(18), COLOR_TEXT_MAIN);
+            DrawText(TextFormat("W Err: %d?? %d? %d?!", wSum.blunders, wSum.mistakes, wSum.inaccuracies), infoX, errY, g.font(14), COLOR_TEXT_DIM);
+            DrawText(TextFormat("B Err: %d?? %d? %d?!", bSum.blunders, bSum.mistakes, bSum.inaccuracies), infoX + g.px(150), errY, g.font(14), COLOR_TEXT_DIM);
         } else if (reviewState == ReviewState::REVIEWING) {
-            DrawRectangle(infoX, 920, tableWidth, 20, Fade(BLACK, 0.5f));
-            DrawRectangle(infoX, 920, tableWidth * gameReviewer.getProgress(), 20, COLOR_SELECTED);
-            DrawText("Analyzing...", infoX + 5, 922, 16, COLOR_BG);
+            DrawRectangle(infoX, summaryY, tableWidth, g.px(20), Fade(BLACK, 0.5f));
+            DrawRectangle(infoX, summaryY, tableWidth * review.progress, g.px(20), COLOR_SELECTED);
+            DrawText("Analyzing...", infoX + g.px(5), summaryY + g.px(2), g.font(16), COLOR_BG);
+        } else if (reviewState == ReviewState::REVIEW_FAILED) {
+            DrawText("Review failed: engine unavailable", infoX, summaryY, g.font(16), RED);
         }
     }
 }
 
-void DrawPasteDialog(bool& showDialog, std::string& dialogText, bool& submitPastedPgn, Vector2 mousePos) {
-    if (!showDialog) return;
+void DrawPasteDialog(const Gui::AppSnapshot& s, Vector2 mousePos) {
+    if (!s.showPasteDialog) return;
+    PROFILE_SCOPE("draw paste dialog");
+    const std::string& dialogText = *s.pasteText;
+    const Geometry& g = current();
     
-    DrawRectangle(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, Fade(BLACK, 0.6f));
+    DrawRectangle(0, 0, g.screenWidth, g.screenHeight, Fade(BLACK, 0.6f));
     
-    int dialogW = DIALOG_W;
-    int dialogH = DIALOG_H;
-    int dialogX = (SCREEN_WIDTH - dialogW) / 2;
-    int dialogY = (SCREEN_HEIGHT - dialogH) / 2;
+    Rectangle dialog = dialogRect();
+    int dialogW = (int)dialog.width;
+    int dialogH = (int)dialog.height;
+    int dialogX = (int)dialog.x;
+    int dialogY = (int)dialog.y;
     
     DrawRectangle(dialogX, dialogY, dialogW, dialogH, COLOR_BG);
     DrawRectangleLines(dialogX, dialogY, dialogW, dialogH, COLOR_TEXT_DIM);
     
-    DrawText("Paste PGN (Ctrl+V)", dialogX + 20, dialogY + 20, 20, COLOR_TEXT_MAIN);
+    DrawText("Paste PGN (Ctrl+V)", dialogX + g.px(20), dialogY + g.px(20), g.font(20), COLOR_TEXT_MAIN);
     
-    bool overX = CheckCollisionPointRec(mousePos, { (float)(dialogX + dialogW - 40), (float)(dialogY + 10), 30, 30 });
-    DrawText("X", dialogX + dialogW - 30, dialogY + 15, 20, overX ? RED : COLOR_TEXT_DIM);
-    if (overX && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-        showDialog = false;
-        dialogText = "";
-    }
+    bool overX = CheckCollisionPointRec(mousePos, dialogCloseRect());
+    DrawText("X", dialogX + dialogW - g.px(30), dialogY + g.px(15), g.font(20), overX ? RED : COLOR_TEXT_DIM);
     
-    DrawRectangle(dialogX + 20, dialogY + 60, dialogW - 40, dialogH - 140, Fade(BLACK, 0.3f));
+    DrawRectangle(dialogX + g.px(20), dialogY + g.px(60), dialogW - g.px(40), dialogH - g.px(140), Fade(BLACK, 0.3f));
     
     std::string preview = dialogText;
     if (preview.length() > 500) preview = preview.substr(0, 500) + "...";
     
     if (dialogText.empty()) {
         int blink = (int)(GetTime() * 2) % 2;
-        if (blink == 0) DrawText("_", dialogX + 25, dialogY + 85, 20, COLOR_TEXT_MAIN);
+        if (blink == 0) DrawText("_", dialogX + g.px(25), dialogY + g.px(85), g.font(20), COLOR_TEXT_MAIN);
     } else {
-        DrawText("Pasted text preview:", dialogX + 25, dialogY + 65, 15, COLOR_TEXT_DIM);
+        int textX = dialogX + g.px(25);
+        int fontSize = g.font(15);
+        int lineHeight = g.px(20);
+        DrawText("Pasted text preview:", textX, dialogY + g.px(65), fontSize, COLOR_TEXT_DIM);
         // Better text wrap rendering
-        int dY = 85;
+        int dY = g.px(85);
+        int maxY = dialogH - g.px(80);
         std::string currentLine = "";
-        int maxWidth = dialogW - 60;
+        int maxWidth = dialogW - g.px(60);
         const char* textPtr = preview.c_str();
         int textLen = (int)preview.length();
         int i = 0;
@@ -370,417 +321,465 @@ void DrawPasteDialog(bool& showDialog, std::string& dialogText, bool& submitPast
              int codepointByteSize = 0;
              int codepoint = GetCodepointNext(&textPtr[i], &codepointByteSize);
              if (codepoint == '\n') {
-                 DrawText(currentLine.c_str(), dialogX + 25, dialogY + dY, 15, COLOR_TEXT_MAIN);
+                 DrawText(currentLine.c_str(), textX, dialogY + dY, fontSize, COLOR_TEXT_MAIN);
                  currentLine = "";
                  currentLineWidth = 0;
-                 dY += 20;
+                 dY += lineHeight;
                  i += codepointByteSize;
              } else {
                  std::string nextPart = preview.substr(i, codepointByteSize);
-                 int nextPartWidth = MeasureText(nextPart.c_str(), 15);
+                 int nextPartWidth = MeasureText(nextPart.c_str(), fontSize);
                  currentLine += nextPart;
                  currentLineWidth += nextPartWidth;
                  if (currentLineWidth > maxWidth) {
-                      DrawText(currentLine.c_str(), dialogX + 25, dialogY + dY, 15, COLOR_TEXT_MAIN);
+                      DrawText(currentLine.c_str(), textX, dialogY + dY, fontSize, COLOR_TEXT_MAIN);
                       currentLine = "";
                       currentLineWidth = 0;
-                      dY += 20;
+                      dY += lineHeight;
                  }
                  i += codepointByteSize;
              }
-             if (dY > dialogH - 80) break;
+             if (dY > maxY) break;
         }
-        if (!currentLine.empty() && dY <= dialogH - 80) {
-             DrawText(currentLine.c_str(), dialogX + 25, dialogY + dY, 15, COLOR_TEXT_MAIN);
+        if (!currentLine.empty() && dY <= maxY) {
+             DrawText(currentLine.c_str(), textX, dialogY + dY, fontSize, COLOR_TEXT_MAIN);
         }
     }
     
-    int btnW = 120;
-    int btnH = 40;
-    int btnX = dialogX + (dialogW - btnW) / 2;
-    int btnY = dialogY + dialogH - 60;
-    bool overBtn = CheckCollisionPointRec(mousePos, { (float)btnX, (float)btnY, (float)btnW, (float)btnH });
-    if (dialogText.empty()) overBtn = false; 
+    Rectangle btn = dialogAnalyzeRect();
+    bool overBtn = !dialogText.empty() && CheckCollisionPointRec(mousePos, btn);
     
-    DrawRectangle(btnX, btnY, btnW, btnH, overBtn ? COLOR_SELECTED : (dialogText.empty() ? Fade(COLOR_DARK, 0.5f) : COLOR_DARK));
-    DrawText("Analyze", btnX + 22, btnY + 10, 20, dialogText.empty() ? COLOR_TEXT_DIM : COLOR_BG);
+    DrawRectangleRec(btn, overBtn ? COLOR_SELECTED : (dialogText.empty() ? Fade(COLOR_DARK, 0.5f) : COLOR_DARK));
+    DrawText("Analyze", (int)btn.x + g.px(22), (int)btn.y + g.px(10), g.font(20), dialogText.empty() ? COLOR_TEXT_DIM : COLOR_BG);
+}
+
+// The whole frame, from the snapshot alone
+void DrawFrame(const Gui::AppSnapshot& s, const Gui::BoardRenderer& board, const Gui::PieceAtlas& pieces,
+               const Gui::MoveTableText& table, const Gui::EvalGraph& graph, Vector2 mousePos) {
+    PROFILE_SCOPE("draw frame");
+    const Geometry& g = current();
+    ClearBackground(COLOR_BG);
     
-    if (overBtn && !dialogText.empty() && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-        submitPastedPgn = true;
-        showDialog = false;
+    // Draw Top Left Buttons
+    int labelY = g.btnMargin + g.px(10);
+    int labelSize = g.font(18);
+    Rectangle flip = topButtonRect(0);
+    DrawRectangleRec(flip, CheckCollisionPointRec(mousePos, flip) ? COLOR_SELECTED : COLOR_DARK);
+    DrawText("Flip Board", (int)flip.x + g.px(10), labelY, labelSize, COLOR_TEXT_MAIN);
+
+    Rectangle reload = topButtonRect(1);
+    DrawRectangleRec(reload, CheckCollisionPointRec(mousePos, reload) ? RED : COLOR_DARK);
+    DrawText("Reload", (int)reload.x + g.px(20), labelY, labelSize, COLOR_TEXT_MAIN);
+
+    if (s.analysisActive) {
+        Rectangle review = topButtonRect(2);
+        DrawRectangleRec(review, CheckCollisionPointRec(mousePos, review) ? COLOR_SELECTED : COLOR_DARK);
+        DrawText("Review", (int)review.x + g.px(35), labelY, labelSize, COLOR_TEXT_MAIN);
     }
-}
 
-int main() {
-    InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Chess Analysis App (Stockfish Enabled)");
-    SetExitKey(KEY_NULL); // Disable ESC to close
-    SetTargetFPS(60);
+    board.draw(s, pieces);
+    // Engine suggestions, the main line on top
+    if (s.analysisCurrent && !s.anim.active) {
+        for (int i = s.analysis.lineCount - 1; i >= 0; i--) {
+            const Gui::AnalysisLine& line = s.analysis.lines[i];
+            if (line.pvLength == 0) continue;
+            Gui::drawMoveArrow(line.pv[0], s.flipped, Fade(ARROW_COLOR, i == 0 ? 0.8f : 0.4f));
+        }
+    }
+    DrawEvalBar(s.analysis, s.flipped);
+
+    // Draw new playback controls
+    if (s.analysisActive) {
+        const char* labels[] = {"|<", "<", "||", ">", ">|"};
+        for (int i = 0; i < 5; i++) {
+            Rectangle btn = playbackButtonRect(i);
+            bool hover = CheckCollisionPointRec(mousePos, btn);
+            DrawRectangleRec(btn, hover ? COLOR_TEXT_DIM : Fade(BLACK, 0.5f));
+            
+            int fontSize = g.font(24);
+            int textW = MeasureText(labels[i], fontSize);
+            DrawText(labels[i], (int)btn.x + ((int)btn.width - textW) / 2, (int)btn.y + ((int)btn.height - fontSize) / 2, fontSize, COLOR_TEXT_MAIN);
+        }
+    }
 
-    // Load Textures
-    Texture2D pieceTextures[14] = {0};
-    std::string appDir = GetApplicationDirectory();
-    std::string textureDir = appDir + "textures/PNGs/No shadow/128h/";
-    pieceTextures[Chess::W_PAWN] = LoadTexture((textureDir + "w_pawn_png_128px.png").c_str());
-    pieceTextures[Chess::W_KNIGHT] = LoadTexture((textureDir + "w_knight_png_128px.png").c_str());
-    pieceTextures[Chess::W_BISHOP] = LoadTexture((textureDir + "w_bishop_png_128px.png").c_str());
-    pieceTextures[Chess::W_ROOK] = LoadTexture((textureDir + "w_rook_png_128px.png").c_str());
-    pieceTextures[Chess::W_QUEEN] = LoadTexture((textureDir + "w_queen_png_128px.png").c_str());
-    pieceTextures[Chess::W_KING] = LoadTexture((textureDir + "w_king_png_128px.png").c_str());
-
-    pieceTextures[Chess::B_PAWN] = LoadTexture((textureDir + "b_pawn_png_128px.png").c_str());
-    pieceTextures[Chess::B_KNIGHT] = LoadTexture((textureDir + "b_knight_png_128px.png").c_str());
-    pieceTextures[Chess::B_BISHOP] = LoadTexture((textureDir + "b_bishop_png_128px.png").c_str());
-    pieceTextures[Chess::B_ROOK] = LoadTexture((textureDir + "b_rook_png_128px.png").c_str());
-    pieceTextures[Chess::B_QUEEN] = LoadTexture((textureDir + "b_queen_png_128px.png").c_str());
-    pieceTextures[Chess::B_KING] = LoadTexture((textureDir + "b_king_png_128px.png").c_str());
-
-    Chess::Board board;
-    board.reset();
-    
-    Chess::GameRecord gameRecord;
-    Engine::StockfishClient engine("stockfish.exe");
-    
-    Chess::GameReviewer gameReviewer;
-    ReviewState reviewState = ReviewState::IDLE;
+    DrawSidePanel(s, table, graph, mousePos);
+    DrawPasteDialog(s, mousePos);
+}
 
-    if (!engine.start()) {
-        std::cerr << "Warning: Could not start stockfish.exe. Analysis disabled." << std::endl;
+#ifdef CHESS_PROFILER
+// F3: frame-time percentiles of the last few seconds of drawn frames and
+// the per-frame time of each timed scope
+void DrawProfilerOverlay() {
+    const Gui::FrameProfiler& prof = Gui::profiler();
+    std::vector<Gui::FrameProfiler::ScopeStats> scopes = prof.scopeStats();
+
+    int w = 300;
+    int x = current().screenWidth - w - 10;
+    int y = 10;
+    DrawRectangle(x, y, w, 50 + (int)scopes.size() * 16, Fade(BLACK, 0.75f));
+    DrawText(TextFormat("frame  p50 %.2f ms  p99 %.2f ms", prof.framePercentile(0.5), prof.framePercentile(0.99)),
+             x + 8, y + 8, 16, COLOR_TEXT_MAIN);
+    DrawText(prof.tracing() ? "F4: stop trace (recording)" : "F4: record trace", x + 8, y + 28, 14,
+             prof.tracing() ? RED : COLOR_TEXT_DIM);
+    for (size_t i = 0; i < scopes.size(); i++) {
+        const auto& sc = scopes[i];
+        int rowY = y + 48 + (int)i * 16;
+        DrawText(sc.name, x + 8, rowY, 14, COLOR_TEXT_DIM);
+        DrawText(TextFormat("%.3f", sc.p50), x + 170, rowY, 14, COLOR_TEXT_DIM);
+        DrawText(TextFormat("%.3f", sc.p99), x + 235, rowY, 14, COLOR_TEXT_DIM);
+    }
+}
+#endif
+
+// Whether the next frame differs from the last one drawn: the model changed
+// (input, animation, engine output, review progress), the pointer moved over
+// hover highlights, or the paste dialog cursor blinked
+class RedrawTracker {
+public:
+    void invalidate() { valid = false; }
+
+    bool needsRedraw(const Gui::AppSnapshot& s, Vector2 mousePos) {
+        int blinkPhase = (s.showPasteDialog && s.pasteText->empty()) ? (int)(GetTime() * 2) % 2 : -1;
+        bool dirty = !valid || s.revision != revision || mousePos.x != mouse.x || mousePos.y != mouse.y || blinkPhase != blink;
+        valid = true;
+        revision = s.revision;
+        mouse = mousePos;
+        blink = blinkPhase;
+        return dirty;
     }
-    
-    std::string currentEval = "N/A";
-    std::string bestMoveSan = "";
-    std::mutex evalMutex;
-    
-    engine.setEvalCallback([&](std::string score, std::string bestMove) {
-        std::lock_guard<std::mutex> lock(evalMutex);
-        currentEval = score;
-        bestMoveSan = bestMove; 
-    });
 
-    AnimState anim;
-    
-    bool gameOver = false;
-    int selectedSq = -1;
-    bool isBoardFlipped = false;
-    bool isAnalysisActive = false;
-    bool showPasteDialog = false;
-    std::string dialogPgnText = "";
-    bool submitPastedPgn = false;
-    int tableScroll = 0;
-    std::string initialFen = board.getFen();
-    
-    auto triggerAnalysis = [&]() {
-        if (reviewState == ReviewState::REVIEWING) return;
-        engine.stopAnalysis();
-        engine.setPosition(board.getFen());
-        engine.go(20); 
-    };
+private:
+    bool valid = false;
+    uint64_t revision = 0;
+    Vector2 mouse = {0, 0};
+    int blink = -1;
+};
 
-    while (!WindowShouldClose()) {
-        float dt = GetFrameTime();
-        Vector2 mousePos = GetMousePosition();
-        
-        if (reviewState == ReviewState::REVIEWING) {
-            if (gameReviewer.isReviewComplete()) {
-                reviewState = ReviewState::REVIEW_DONE;
-                triggerAnalysis();
-            }
-        }
-        
-        if (IsFileDropped()) {
-            FilePathList droppedFiles = LoadDroppedFiles();
-            if (droppedFiles.count > 0) {
-                char* text = LoadFileText(droppedFiles.paths[0]);
-                if (text) {
-                    dialogPgnText = text;
-                    showPasteDialog = true;
-                    UnloadFileText(text);
-                }
-            }
-            UnloadDroppedFiles(droppedFiles);
-            selectedSq = -1;
+// Window size for a wanted size: within most of the monitor, at least the
+// minimum, the aspect kept when it has to shrink
+void ResizeWindowWithin(float width, float height) {
+    int monitor = GetCurrentMonitor();
+    float maxW = GetMonitorWidth(monitor) * 0.9f;
+    float maxH = GetMonitorHeight(monitor) * 0.9f;
+    float fit = std::min({ 1.0f, maxW / width, maxH / height });
+    SetWindowSize(std::max((int)(width * fit), MIN_WIDTH), std::max((int)(height * fit), MIN_HEIGHT));
+}
+
+// Follows the window's size and DPI scale. Sizes are in screen pixels; the
+// DPI scale only decides how big a window to ask for, so the same layout
+// looks the same size on a dense screen and gets sharper pieces.
+class LayoutTracker {
+public:
+    explicit LayoutTracker(float dpiScale)
+        : dpi(dpiScale), width(GetScreenWidth()), height(GetScreenHeight()) {}
+
+    // True once the window has settled at a size the current layout was not
+    // computed for
+    bool poll(double now) {
+        // Moved to a screen with another scale: grow or shrink with it
+        float newDpi = GetWindowScaleDPI().x;
+        if (newDpi > 0 && newDpi != dpi) {
+            if (!IsWindowFullscreen()) ResizeWindowWithin(GetScreenWidth() * newDpi / dpi, GetScreenHeight() * newDpi / dpi);
+            dpi = newDpi;
         }
-        
-        if (IsKeyPressed(KEY_F11)) {
-            ToggleFullscreen();
+        int w = GetScreenWidth();
+        int h = GetScreenHeight();
+        if (w != width || h != height) {
+            width = w;
+            height = h;
+            changedAt = now;
         }
+        const Geometry& g = current();
+        return (w != g.screenWidth || h != g.screenHeight) && now - changedAt >= LAYOUT_SETTLE_SECONDS;
+    }
 
-        if (anim.active) {
-            anim.progress += dt * anim.speed;
-            if (anim.progress >= 1.0f) {
-                anim.active = false;
+private:
+    float dpi;
+    int width;
+    int height;
+    double changedAt = 0.0;
+};
+
+// Raylib input of this frame as model events
+void CollectEvents(const Gui::AppSnapshot& s, Vector2 mousePos, std::vector<Gui::AppEvent>& events) {
+    PROFILE_SCOPE("input");
+    using Gui::AppEvent;
+    using Gui::AppEventType;
+
+    events.push_back({AppEventType::Tick, std::min(GetFrameTime(), MAX_FRAME_DT)});
+
+    if (IsFileDropped()) {
+        FilePathList droppedFiles = LoadDroppedFiles();
+        if (droppedFiles.count > 0) {
+            char* text = LoadFileText(droppedFiles.paths[0]);
+            if (text) {
+                AppEvent e{AppEventType::FileDropped};
+                e.text = text;
+                events.push_back(e);
+                UnloadFileText(text);
             }
         }
+        UnloadDroppedFiles(droppedFiles);
+    }
 
-        if (showPasteDialog && IsKeyPressed(KEY_V) && (IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL))) {
-            std::string content = "";
+    if (s.showPasteDialog) {
+        if (IsKeyPressed(KEY_V) && (IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL))) {
+            AppEvent e{AppEventType::SetPasteText};
             const char* clipboardText = GetClipboardText();
-            if (clipboardText) content = clipboardText;
-            else content = GetClipboardTextFallback();
-            if (!content.empty()) dialogPgnText = content;
+            if (clipboardText) e.text = clipboardText;
+            else e.text = GetClipboardTextFallback();
+            events.push_back(e);
         }
-
-        if (submitPastedPgn) {
-            submitPastedPgn = false;
-            if (dialogPgnText.find("[Event") != std::string::npos || dialogPgnText.find("1.") != std::string::npos) {
-                initialFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
-                LoadPgnToRecord(dialogPgnText, board, gameRecord);
-            } else {
-                initialFen = dialogPgnText;
-                board.loadFen(dialogPgnText);
-                gameRecord.reset();
-            }
-            isAnalysisActive = true;
-            triggerAnalysis();
-            selectedSq = -1;
+        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+            if (CheckCollisionPointRec(mousePos, dialogCloseRect())) events.push_back({AppEventType::ClosePasteDialog});
+            else if (CheckCollisionPointRec(mousePos, dialogAnalyzeRect())) events.push_back({AppEventType::SubmitPaste});
         }
+        return;
+    }
 
-        if (!anim.active && !showPasteDialog && reviewState != ReviewState::REVIEWING) {
-            if (IsKeyPressed(KEY_RIGHT) && gameRecord.hasNext()) {
-                Chess::Move m = gameRecord.next();
-                anim.active = true;
-                anim.piece = board.getPiece(m.from);
-                anim.progress = 0.0f;
-                int f1 = m.from % 8; int r1 = m.from / 8;
-                int f2 = m.dest % 8; int r2 = m.dest / 8;
-                int drawR1 = isBoardFlipped ? r1 : (7 - r1);
-                int drawF1 = isBoardFlipped ? (7 - f1) : f1;
-                int drawR2 = isBoardFlipped ? r2 : (7 - r2);
-                int drawF2 = isBoardFlipped ? (7 - f2) : f2;
-                anim.startPos = {(float)(BOARD_OFFSET_X + drawF1 * SQUARE_SIZE), (float)(BOARD_OFFSET_Y + drawR1 * SQUARE_SIZE)};
-                anim.endPos = {(float)(BOARD_OFFSET_X + drawF2 * SQUARE_SIZE), (float)(BOARD_OFFSET_Y + drawR2 * SQUARE_SIZE)};
-                board.makeMove(m);
-                triggerAnalysis();
-                selectedSq = -1;
-            }
-            else if (IsKeyPressed(KEY_LEFT) && gameRecord.hasPrev()) {
-                board.undoMove();
-                gameRecord.prev();
-                triggerAnalysis();
-                selectedSq = -1;
-            }
-        }
+    if (IsKeyPressed(KEY_RIGHT)) events.push_back({AppEventType::Next});
+    else if (IsKeyPressed(KEY_LEFT)) events.push_back({AppEventType::Prev});
 
-        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && !showPasteDialog) {
-            bool clickedUI = false;
-            
-            // Top Left Buttons
-        if (CheckCollisionPointRec(mousePos, { (float)BOARD_OFFSET_X, (float)BTN_MARGIN, (float)BTN_WIDTH, (float)BTN_HEIGHT })) {
-                 isBoardFlipped = !isBoardFlipped;
-                 clickedUI = true;
-        } else if (CheckCollisionPointRec(mousePos, { (float)BOARD_OFFSET_X + BTN_WIDTH + BTN_MARGIN, (float)BTN_MARGIN, (float)BTN_WIDTH, (float)BTN_HEIGHT })) {
-                 board.loadFen(initialFen);
-                 gameRecord.reset();
-                 isAnalysisActive = false;
-                 reviewState = ReviewState::IDLE;
-                 triggerAnalysis();
-                 selectedSq = -1;
-                 clickedUI = true;
-        } else if (isAnalysisActive && CheckCollisionPointRec(mousePos, { (float)BOARD_OFFSET_X + 2 * (BTN_WIDTH + BTN_MARGIN), (float)BTN_MARGIN, (float)BTN_WIDTH + 20, (float)BTN_HEIGHT })) {
-                 if (reviewState != ReviewState::REVIEWING) {
-                     std::vector<std::string> fens;
-                     Chess::Board tempBoard;
-                     tempBoard.loadFen(initialFen);
-                     fens.push_back(tempBoard.getFen());
-                     for (const auto& m : gameRecord.moves) {
-                         tempBoard.makeMove(m);
-                         fens.push_back(tempBoard.getFen());
-                     }
-                     std::string game_result = "";
-                     size_t resPos = dialogPgnText.find("[Result \"");
-                     if (resPos != std::string::npos) {
-                         size_t endPos = dialogPgnText.find("\"", resPos + 9);
-                         if (endPos != std::string::npos) {
-                             game_result = dialogPgnText.substr(resPos + 9, endPos - (resPos + 9));
-                         }
-                     }
-                     gameReviewer.startReview(fens, engine, 18, game_result);
-                     reviewState = ReviewState::REVIEWING;
-                 }
-                 clickedUI = true;
-            }
-            // Paste Button
-            else if (!isAnalysisActive && CheckCollisionPointRec(mousePos, { (float)(INFO_X), (float)BTN_PASTE_Y, (float)BTN_PASTE_W, (float)BTN_HEIGHT })) {
-                showPasteDialog = true;
-                clickedUI = true;
-            }
-            // Playback controls (Now under the board)
-            else if (isAnalysisActive) {
-                int btnW = BTN_PLAYBACK_WIDTH;
-                int btnH = BTN_PLAYBACK_HEIGHT;
-                // Center relative to the board: X: BOARD_OFFSET_X to BOARD_OFFSET_X + BOARD_SIZE
-                int startX = BOARD_OFFSET_X + (BOARD_SIZE - (5 * btnW + 4 * 10)) / 2;
-                int btnY = BOARD_OFFSET_Y + BOARD_SIZE + BTN_MARGIN;
-                
-                for (int i=0; i<5; i++) {
-                    int bx = startX + i * (btnW + 10);
-                    if (CheckCollisionPointRec(mousePos, { (float)bx, (float)btnY, (float)btnW, (float)btnH })) {
-                        clickedUI = true;
-                        if (i == 0) {
-                            while(gameRecord.hasPrev()) { board.undoMove(); gameRecord.prev(); }
-                            triggerAnalysis();
-                        } else if (i == 1) {
-                            if(gameRecord.hasPrev()) { board.undoMove(); gameRecord.prev(); triggerAnalysis(); }
-                        } else if (i == 2) {
-                            
-                        } else if (i == 3 && !anim.active) {
-                            if(gameRecord.hasNext()) {
-                                Chess::Move m = gameRecord.next();
-                                anim.active = true;
-                                anim.piece = board.getPiece(m.from);
-                                anim.progress = 0.0f;
-                                int f1 = m.from % 8; int r1 = m.from / 8;
-                                int f2 = m.dest % 8; int r2 = m.dest / 8;
-                                int drawR1 = isBoardFlipped ? r1 : (7 - r1);
-                                int drawF1 = isBoardFlipped ? (7 - f1) : f1;
-                                int drawR2 = isBoardFlipped ? r2 : (7 - r2);
-                                int drawF2 = isBoardFlipped ? (7 - f2) : f2;
-                                anim.startPos = {(float)(BOARD_OFFSET_X + drawF1 * SQUARE_SIZE), (float)(BOARD_OFFSET_Y + drawR1 * SQUARE_SIZE)};
-                                anim.endPos = {(float)(BOARD_OFFSET_X + drawF2 * SQUARE_SIZE), (float)(BOARD_OFFSET_Y + drawR2 * SQUARE_SIZE)};
-                                board.makeMove(m);
-                                triggerAnalysis();
-                            }
-                        } else if (i == 4) {
-                            while(gameRecord.hasNext()) { board.makeMove(gameRecord.next()); }
-                            triggerAnalysis();
-                        }
-                        selectedSq = -1;
-                    }
-                }
-            }
+    if (s.analysisActive && CheckCollisionPointRec(mousePos, moveTableRect())) {
+        float wheel = GetMouseWheelMove();
+        AppEvent e{AppEventType::ScrollTable};
+        e.amount = (wheel > 0) ? -3 : 3;
+        if (wheel != 0) events.push_back(e);
+    }
 
-            if (!clickedUI && !anim.active && reviewState != ReviewState::REVIEWING) {
-                if (mousePos.x >= BOARD_OFFSET_X && mousePos.x < BOARD_OFFSET_X + BOARD_SIZE &&
-                    mousePos.y >= BOARD_OFFSET_Y && mousePos.y < BOARD_OFFSET_Y + BOARD_SIZE) {
-                    
-                    int uiF = (mousePos.x - BOARD_OFFSET_X) / SQUARE_SIZE;
-                    int uiR = (mousePos.y - BOARD_OFFSET_Y) / SQUARE_SIZE;
-                    int file = isBoardFlipped ? (7 - uiF) : uiF;
-                    int rank = isBoardFlipped ? uiR : (7 - uiR);
-                    int sq = (7 - rank) * 8 + file;
-                    
-                    if (selectedSq == -1) {
-                        Chess::Piece p = board.getPiece(sq);
-                        if (p != Chess::NO_PIECE && Chess::colorOf(p) == board.getTurn()) {
-                            selectedSq = sq;
-                        }
-                    } else {
-                        Chess::Move m;
-                        m.from = selectedSq;
-                        m.dest = sq;
-                        m.promotion = Chess::NO_PIECE_TYPE;
-                        
-                        Chess::Piece p = board.getPiece(selectedSq);
-                        if (Chess::typeOf(p) == Chess::PAWN) {
-                             int r = sq / 8;
-                             if (r == 0 || r == 7) m.promotion = Chess::QUEEN; 
-                        }
-                        
-                        std::vector<Chess::Move> legal = board.getLegalMoves();
-                        bool found = false;
-                        for (const auto& lm : legal) {
-                            if (lm.from == m.from && lm.dest == m.dest && (m.promotion == Chess::NO_PIECE_TYPE || lm.promotion == m.promotion)) {
-                                m = lm; 
-                                found = true; 
-                                break;
-                            }
-                        }
-                        
-                        if (found) {
-                            if (gameRecord.hasNext()) {
-                                 Chess::Move nextRec = gameRecord.moves[gameRecord.currentIndex];
-                                 if (nextRec.from != m.from || nextRec.dest != m.dest || nextRec.promotion != m.promotion) {
-                                     gameRecord.addMove(m, board.moveToSan(m)); 
-                                 } else {
-                                     gameRecord.currentIndex++;
-                                 }
-                            } else {
-                                 gameRecord.addMove(m, board.moveToSan(m));
-                            }
-
-                            anim.active = true;
-                            anim.piece = p;
-                            anim.progress = 0.0f;
-                            int f1 = m.from % 8; int r1 = m.from / 8;
-                            int f2 = m.dest % 8; int r2 = m.dest / 8;
-                            int drawR1 = isBoardFlipped ? r1 : (7 - r1);
-                            int drawF1 = isBoardFlipped ? (7 - f1) : f1;
-                            int drawR2 = isBoardFlipped ? r2 : (7 - r2);
-                            int drawF2 = isBoardFlipped ? (7 - f2) : f2;
-                            anim.startPos = {(float)(BOARD_OFFSET_X + drawF1 * SQUARE_SIZE), (float)(BOARD_OFFSET_Y + drawR1 * SQUARE_SIZE)};
-                            anim.endPos = {(float)(BOARD_OFFSET_X + drawF2 * SQUARE_SIZE), (float)(BOARD_OFFSET_Y + drawR2 * SQUARE_SIZE)};
-
-                            board.makeMove(m);
-                            triggerAnalysis();
-                            selectedSq = -1;
-                        } else {
-                            Chess::Piece target = board.getPiece(sq);
-                            if (target != Chess::NO_PIECE && Chess::colorOf(target) == board.getTurn()) {
-                                selectedSq = sq;
-                            } else {
-                                selectedSq = -1;
-                            }
-                        }
-                    }
-                }
+    if (!IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) return;
+
+    if (CheckCollisionPointRec(mousePos, topButtonRect(0))) {
+        events.push_back({AppEventType::FlipBoard});
+    } else if (CheckCollisionPointRec(mousePos, topButtonRect(1))) {
+        events.push_back({AppEventType::Reload});
+    } else if (s.analysisActive && CheckCollisionPointRec(mousePos, topButtonRect(2))) {
+        events.push_back({AppEventType::StartReview});
+    } else if (!s.analysisActive && CheckCollisionPointRec(mousePos, pasteButtonRect())) {
+        events.push_back({AppEventType::OpenPasteDialog});
+    } else {
+        if (s.analysisActive) {
+            for (int i = 0; i < 5; i++) {
+                if (!CheckCollisionPointRec(mousePos, playbackButtonRect(i))) continue;
+                if (i == 0) events.push_back({AppEventType::First});
+                else if (i == 1) events.push_back({AppEventType::Prev});
+                else if (i == 3) events.push_back({AppEventType::Next});
+                else if (i == 4) events.push_back({AppEventType::Last});
+                return;
             }
         }
+        AppEvent e{AppEventType::SquareClicked};
+        e.square = Gui::squareAt(mousePos, s.flipped);
+        if (e.square != Chess::SQUARE_NONE) events.push_back(e);
+    }
+}
 
-        BeginDrawing();
-        ClearBackground(COLOR_BG);
-        
-        // Draw Top Left Buttons
-        DrawRectangle(BOARD_OFFSET_X, BTN_MARGIN, BTN_WIDTH, BTN_HEIGHT, CheckCollisionPointRec(mousePos, { (float)BOARD_OFFSET_X, (float)BTN_MARGIN, (float)BTN_WIDTH, (float)BTN_HEIGHT }) ? COLOR_SELECTED : COLOR_DARK);
-        DrawText("Flip Board", BOARD_OFFSET_X + 10, BTN_MARGIN + 10, 18, COLOR_TEXT_MAIN);
+int main() {
+    StartupMetrics startup(StartupMetrics::Clock::now());
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE);
+    InitWindow(DESIGN_WIDTH, DESIGN_HEIGHT, "Chess Analysis App (Stockfish Enabled)");
+    SetWindowMinSize(MIN_WIDTH, MIN_HEIGHT);
+    SetExitKey(KEY_NULL); // Disable ESC to close
+    SetTargetFPS(ACTIVE_FPS);
+
+    // The design size is in logical pixels; a scaled screen gets a window
+    // as much bigger, laid out from its actual size
+    float dpiScale = GetWindowScaleDPI().x;
+    if (dpiScale > 1.0f) ResizeWindowWithin(DESIGN_WIDTH * dpiScale, DESIGN_HEIGHT * dpiScale);
+    setCurrent(computeGeometry(GetScreenWidth(), GetScreenHeight()));
+    LayoutTracker layoutTracker(dpiScale);
+
+    // Startup is staged: the first frame is drawn while the piece images are
+    // decoded and the engine is spawned; each is picked up when it is done.
+    // All pieces come from one atlas texture, uploaded on this thread, from
+    // the image size that suits the squares; a resize to another size
+    // decodes again in the background while the old pieces are drawn.
+    std::string appDir = GetApplicationDirectory();
+    std::string pieceDir = appDir + "textures/PNGs/No shadow/";
+    Gui::PieceAtlas pieceAtlas;
+    auto decodePieces = [&pieceAtlas, pieceDir](int spriteSize) {
+        return std::async(std::launch::async, [&pieceAtlas, pieceDir, spriteSize]() {
+            return pieceAtlas.decode(pieceDir, spriteSize);
+        });
+    };
+    int pieceSize = Gui::PieceAtlas::spriteSizeFor(current().squareSize);
+    std::future<bool> piecesDecoded = decodePieces(pieceSize);
 
-        DrawRectangle(BOARD_OFFSET_X + BTN_WIDTH + BTN_MARGIN, BTN_MARGIN, BTN_WIDTH, BTN_HEIGHT, CheckCollisionPointRec(mousePos, { (float)BOARD_OFFSET_X + BTN_WIDTH + BTN_MARGIN, (float)BTN_MARGIN, (float)BTN_WIDTH, (float)BTN_HEIGHT }) ? RED : COLOR_DARK);
-        DrawText("Reload", BOARD_OFFSET_X + BTN_WIDTH + BTN_MARGIN + 20, BTN_MARGIN + 10, 18, COLOR_TEXT_MAIN);
+    Engine::StockfishClient engine("stockfish.exe");
 
-        if (isAnalysisActive) {
-            DrawRectangle(BOARD_OFFSET_X + 2 * (BTN_WIDTH + BTN_MARGIN), BTN_MARGIN, BTN_WIDTH + 20, BTN_HEIGHT, CheckCollisionPointRec(mousePos, { (float)BOARD_OFFSET_X + 2 * (BTN_WIDTH + BTN_MARGIN), (float)BTN_MARGIN, (float)BTN_WIDTH + 20, (float)BTN_HEIGHT }) ? COLOR_SELECTED : COLOR_DARK);
-            DrawText("Review", BOARD_OFFSET_X + 2 * (BTN_WIDTH + BTN_MARGIN) + 35, BTN_MARGIN + 10, 18, COLOR_TEXT_MAIN);
-        }
+    // Results survive between sessions; positions already searched deep
+    // enough are answered without touching the engine
+    Engine::AnalysisCache analysisCache;
+    std::string cachePath = appDir + "analysis_cache.bin";
+    analysisCache.load(cachePath);
+    engine.setCache(&analysisCache);
+    
+    Chess::ReviewStore reviewStore(appDir + "reviews");
+    Chess::GameReviewer gameReviewer;
+    gameReviewer.setStore(&reviewStore);
+
+    // Spawn and handshake; an empty result means the engine is ready
+    std::future<std::string> engineStartup = std::async(std::launch::async, [&]() -> std::string {
+        if (!engine.start()) return "stockfish.exe not found";
+        if (engine.ping(ENGINE_HANDSHAKE_TIMEOUT_MS)) return "";
+        engine.stop();
+        return "stockfish.exe not responding";
+    });
+    Engine::EngineSupervisor engineSupervisor(engine);
 
-        DrawBoardBackground(selectedSq, isBoardFlipped);
-        DrawPieces(board, anim, isBoardFlipped, pieceTextures);
+    // Game review runs on its own engines, started on first use, so plies
+    // are searched in parallel while the interactive engine stays free
+    Engine::EnginePool reviewEngines("stockfish.exe");
+    reviewEngines.setCache(&analysisCache);
+    
+    // Navigation goes through the scheduler so rapid position changes are
+    // coalesced and output of superseded searches never reaches the eval bar
+    Engine::AnalysisScheduler analysisScheduler(engine);
 
-        std::string safeEval;
-        {
-            std::lock_guard<std::mutex> lock(evalMutex);
-            safeEval = currentEval;
+    Gui::AppHooks hooks;
+    hooks.analyze = [&](const std::string& startFen, const std::vector<std::string>& moves) {
+        return analysisScheduler.submit(startFen, moves);
+    };
+    hooks.cancelAnalysis = [&]() { analysisScheduler.cancel(); };
+    hooks.startReview = [&](const std::vector<std::string>& fens, const std::vector<std::string>& uciMoves, const std::string& result) {
+        // The reviewer starts the engines on its worker; with none the
+        // review fails and the panel says so
+        Chess::ReviewSettings reviewSettings;
+        reviewSettings.adaptive = true;
+        gameReviewer.startReview(fens, uciMoves, reviewEngines, reviewSettings, result);
+    };
+    hooks.restoreReview = [&](const std::vector<std::string>& fens, const std::vector<std::string>& uciMoves, const std::string& result) {
+        return gameReviewer.restoreReview(fens, uciMoves, result);
+    };
+    hooks.cancelReview = [&]() { gameReviewer.cancel(); };
+    hooks.reviewSnapshot = [&]() { return gameReviewer.snapshot(); };
+    Gui::AppModel model(hooks);
+    model.setVisibleRows(current().visibleRows());
+
+    // Positions submitted before the engine is up wait in the scheduler,
+    // which starts once the handshake is done
+    analysisScheduler.setUpdateCallback([&](const Engine::AnalysisUpdate& update) { model.onAnalysis(update); });
+
+    // A crashed or unresponsive engine is restarted with the same options;
+    // whatever the eval bar was showing is then searched again
+    engineSupervisor.setRestartCallback([&]() { analysisScheduler.replay(); });
+
+    std::vector<Gui::AppEvent> events;
+    Gui::AppSnapshot snap = model.snapshot();
+    RedrawTracker redraw;
+    Gui::BoardRenderer boardRenderer;
+    Gui::MoveTableText moveTable;
+    Gui::EvalGraph evalGraph;
+#ifdef CHESS_PROFILER
+    bool showProfiler = false;
+    std::string tracePath = appDir + "frame_trace.json";
+#endif
+    while (!WindowShouldClose()) {
+#ifdef CHESS_PROFILER
+        Gui::profiler().beginFrame();
+        if (IsKeyPressed(KEY_F3)) {
+            showProfiler = !showProfiler;
+            redraw.invalidate();
         }
-        DrawEvalBar(safeEval, isBoardFlipped);
-
-        // Draw new playback controls
-        if (isAnalysisActive) {
-            int btnW = BTN_PLAYBACK_WIDTH;
-            int btnH = BTN_PLAYBACK_HEIGHT;
-            int startX = BOARD_OFFSET_X + (BOARD_SIZE - (5 * btnW + 4 * 10)) / 2;
-            int btnY = BOARD_OFFSET_Y + BOARD_SIZE + BTN_MARGIN;
-
-            const char* labels[] = {"|<", "<", "||", ">", ">|"};
-            for (int i = 0; i < 5; i++) {
-                int bx = startX + i * (btnW + 10);
-                bool hover = CheckCollisionPointRec(mousePos, { (float)bx, (float)btnY, (float)btnW, (float)btnH });
-                DrawRectangle(bx, btnY, btnW, btnH, hover ? COLOR_TEXT_DIM : Fade(BLACK, 0.5f));
-                
-                int textW = MeasureText(labels[i], 24);
-                DrawText(labels[i], bx + (btnW - textW) / 2, btnY + 13, 24, COLOR_TEXT_MAIN);
+        if (IsKeyPressed(KEY_F4)) {
+            if (!Gui::profiler().tracing()) {
+                Gui::profiler().startTrace();
+            } else {
+                Gui::profiler().stopTrace();
+                if (Gui::profiler().writeTrace(tracePath)) std::cout << "Frame trace written to " << tracePath << std::endl;
+                else std::cerr << "Warning: Could not write " << tracePath << std::endl;
             }
+            redraw.invalidate();
+        }
+#endif
+        // Background startup work that finished since the last frame
+        if (piecesDecoded.valid() && piecesDecoded.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            if (piecesDecoded.get() && pieceAtlas.upload()) {
+                startup.mark(startup.piecesReady, "piece textures ready");
+                boardRenderer.invalidate();
+                redraw.invalidate();
+            } else {
+                std::cerr << "Warning: Could not load piece textures." << std::endl;
+            }
+        }
+        if (engineStartup.valid() && engineStartup.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            Gui::AppEvent e{Gui::AppEventType::EngineReady};
+            std::string error = engineStartup.get();
+            if (error.empty()) {
+                startup.mark(startup.engineReady, "engine ready");
+                analysisScheduler.start();
+                engineSupervisor.start();
+                e.text = engine.getEngineName();
+                if (e.text.empty()) e.text = "ready";
+            } else {
+                std::cerr << "Warning: " << error << ". Analysis disabled." << std::endl;
+                e.type = Gui::AppEventType::EngineFailed;
+                e.text = error;
+            }
+            model.handle(e);
         }
 
-        DrawSidePanel(showPasteDialog, isAnalysisActive, tableScroll, gameRecord, currentEval, bestMoveSan, evalMutex, board.getTurn(), mousePos, reviewState, gameReviewer);
-        DrawPasteDialog(showPasteDialog, dialogPgnText, submitPastedPgn, mousePos);
-        
+        Vector2 mousePos = GetMousePosition();
+        if (IsKeyPressed(KEY_F11)) {
+            ToggleFullscreen();
+            redraw.invalidate();
+        }
+        // Until the size settles, the old layout is drawn over the new area
+        if (IsWindowResized()) redraw.invalidate();
+        if (layoutTracker.poll(GetTime())) {
+            // Cached layers follow the sizes in the new layout on their next
+            // update, and only those whose size changed are rebuilt
+            setCurrent(computeGeometry(GetScreenWidth(), GetScreenHeight()));
+            model.setVisibleRows(current().visibleRows());
+            redraw.invalidate();
+        }
+        int wantedPieceSize = Gui::PieceAtlas::spriteSizeFor(current().squareSize);
+        if (wantedPieceSize != pieceSize && !piecesDecoded.valid()) {
+            pieceSize = wantedPieceSize;
+            piecesDecoded = decodePieces(pieceSize);
+        }
+
+        // Input is read against what the last frame showed
+        events.clear();
+        CollectEvents(snap, mousePos, events);
+        for (const auto& e : events) model.handle(e);
+
+        snap = model.snapshot();
+        if (!redraw.needsRedraw(snap, mousePos)) {
+            // Engine output wakes nothing up, so wait a bounded time rather
+            // than for window events
+            WaitTime(1.0 / IDLE_POLL_HZ);
+            PollInputEvents();
+            continue;
+        }
+        boardRenderer.update(snap, pieceAtlas);
+        moveTable.update(snap, current().font(MOVE_FONT_SIZE));
+        if (snap.reviewState != ReviewState::IDLE) evalGraph.update(snap.review, evalGraphRect());
+        BeginDrawing();
+        DrawFrame(snap, boardRenderer, pieceAtlas, moveTable, evalGraph, mousePos);
+#ifdef CHESS_PROFILER
+        // The overlay shows the frames before this one
+        if (showProfiler) DrawProfilerOverlay();
+        Gui::profiler().endFrame();
+#endif
         EndDrawing();
+        startup.mark(startup.firstFrame, "first frame");
+        if (snap.analysis.sequence > 0) startup.mark(startup.firstEval, "first eval");
     }
     
+    // Startup work still running is finished before anything is torn down
+    if (piecesDecoded.valid()) piecesDecoded.wait();
+    if (engineStartup.valid()) engineStartup.wait();
+
+    engineSupervisor.stop();
+    analysisScheduler.stop();
     engine.stop();
-    for (int i = 0; i < 14; i++) {
-        if (pieceTextures[i].id != 0) {
-            UnloadTexture(pieceTextures[i]);
-        }
-    }
+    gameReviewer.cancel();
+    reviewEngines.stop();
+    analysisCache.save(cachePath);
+    boardRenderer.unload();
+    evalGraph.unload();
+    pieceAtlas.unload();
     
     CloseWindow();
     return 0;
@@ -0,0 +1,429 @@
+// chess-review: headless batch review of PGN files.
+//
+//   chess-review [options] <file.pgn | directory>...
+//
+// Games are spread over a pool of single-threaded engines. Every finished
+// game is appended to the output and then recorded in the checkpoint file,
+// so an interrupted run continues where it stopped when started again.
+#include "core/board.hpp"
+#include "core/pgn.hpp"
+#include "engine/stockfish.hpp"
+#include "engine/engine_pool.hpp"
+#include "engine/game_reviewer.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <algorithm>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct ReviewOptions {
+    std::vector<std::string> inputs;
+    std::string enginePath =
+#ifdef _WIN32
+        "stockfish.exe";
+#else
+        "stockfish";
+#endif
+    std::string outPath = "review.jsonl";
+    std::string checkpointPath;     // default: <out>.checkpoint
+    bool csv = false;
+    bool fresh = false;             // ignore and overwrite previous progress
+    int jobs = 0;                   // 0: one engine per hardware thread
+    int hashMb = 0;                 // 0: 16 MB per engine
+    Engine::SearchLimits limits;
+    uint64_t nodeBudget = 0;        // per game
+    int timeBudgetMs = 0;           // per game
+    bool adaptive = false;
+    int shallowDepth = 10;
+    bool reuseBestMove = true;
+};
+
+struct PgnGame {
+    std::string id;     // "<file>#<index>", stable across runs
+    std::string pgn;
+};
+
+void printUsage() {
+    std::cerr <<
+        "usage: chess-review [options] <file.pgn | directory>...\n"
+        "  --depth N         search depth per position (default 18)\n"
+        "  --nodes N         node limit per position\n"
+        "  --movetime MS     time limit per position\n"
+        "  --node-budget N   nodes per game, spread over the positions (reproducible)\n"
+        "  --time-budget MS  time per game, spread over the positions\n"
+        "  --adaptive        shallow pass, then --depth only on critical plies\n"
+        "  --shallow N       depth of the adaptive shallow pass (default 10)\n"
+        "  --no-reuse        search every position, even after the engine's best move\n"
+        "  --jobs N          engine processes (default: hardware threads)\n"
+        "  --hash MB         total hash over all engines\n"
+        "  --engine PATH     UCI engine executable\n"
+        "  --out FILE        output, .jsonl or .csv (default review.jsonl)\n"
+        "  --checkpoint FILE progress file (default <out>.checkpoint)\n"
+        "  --fresh           start over instead of resuming\n";
+}
+
+bool parseArgs(int argc, char** argv, ReviewOptions& opts) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument(arg + " needs a value");
+            return argv[++i];
+        };
+        if (arg == "--depth") opts.limits.depth = std::stoi(value());
+        else if (arg == "--nodes") opts.limits.nodes = std::stoull(value());
+        else if (arg == "--movetime") opts.limits.movetimeMs = std::stoi(value());
+        else if (arg == "--node-budget") opts.nodeBudget = std::stoull(value());
+        else if (arg == "--time-budget") opts.timeBudgetMs = std::stoi(value());
+        else if (arg == "--adaptive") opts.adaptive = true;
+        else if (arg == "--shallow") opts.shallowDepth = std::stoi(value());
+        else if (arg == "--no-reuse") opts.reuseBestMove = false;
+        else if (arg == "--jobs") opts.jobs = std::stoi(value());
+        else if (arg == "--hash") opts.hashMb = std::stoi(value());
+        else if (arg == "--engine") opts.enginePath = value();
+        else if (arg == "--out") opts.outPath = value();
+        else if (arg == "--checkpoint") opts.checkpointPath = value();
+        else if (arg == "--fresh") opts.fresh = true;
+        else if (arg == "-h" || arg == "--help") return false;
+        else if (!arg.empty() && arg[0] == '-') throw std::invalid_argument("unknown option " + arg);
+        else opts.inputs.push_back(arg);
+    }
+    if (opts.limits.depth == 0 && opts.limits.nodes == 0 && opts.limits.movetimeMs == 0) {
+        opts.limits.depth = 18; // Same as the GUI review
+    }
+    if (opts.checkpointPath.empty()) opts.checkpointPath = opts.outPath + ".checkpoint";
+    opts.csv = fs::path(opts.outPath).extension() == ".csv";
+    return !opts.inputs.empty();
+}
+
+std::vector<std::string> collectPgnFiles(const std::vector<std::string>& inputs) {
+    std::vector<std::string> files;
+    for (const auto& input : inputs) {
+        std::error_code ec;
+        if (fs::is_directory(input, ec)) {
+            std::vector<std::string> found;
+            for (const auto& entry : fs::recursive_directory_iterator(input, ec)) {
+                if (entry.is_regular_file() && entry.path().extension() == ".pgn") {
+                    found.push_back(entry.path().string());
+                }
+            }
+            std::sort(found.begin(), found.end()); // Stable game ids and order
+            files.insert(files.end(), found.begin(), found.end());
+        } else {
+            files.push_back(input);
+        }
+    }
+    return files;
+}
+
+std::vector<PgnGame> loadGames(const std::vector<std::string>& files) {
+    std::vector<PgnGame> games;
+    for (const auto& file : files) {
+        std::ifstream in(file, std::ios::binary);
+        if (!in) {
+            std::cerr << "warning: cannot read " << file << std::endl;
+            continue;
+        }
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        auto pgns = Chess::splitPgnGames(buffer.str());
+        for (size_t i = 0; i < pgns.size(); i++) {
+            games.push_back({file + "#" + std::to_string(i + 1), pgns[i]});
+        }
+    }
+    return games;
+}
+
+std::set<std::string> loadCheckpoint(const std::string& path) {
+    std::set<std::string> done;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty()) done.insert(line);
+    }
+    return done;
+}
+
+std::string jsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if ((unsigned char)c < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out + "\"";
+}
+
+std::string csvField(const std::string& s) {
+    if (s.find_first_of(",\"\n") == std::string::npos) return s;
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    return out + "\"";
+}
+
+std::string formatFloat(float v) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.1f", v);
+    return buf;
+}
+
+struct ReviewedGame {
+    std::string id;
+    std::string white;
+    std::string black;
+    std::string result;
+    std::vector<std::string> sanMoves;
+    std::vector<std::string> uciMoves;
+    std::vector<Chess::MoveReview> reviews;
+    Chess::ReviewReport report;
+    Chess::ReviewStats stats;
+};
+
+enum class ReviewOutcome {
+    Reviewed,
+    Skipped,    // no moves, or movetext that doesn't parse
+    Failed      // the engine could not finish a search, even after a restart
+};
+
+// Only a Reviewed game is complete and may be written
+ReviewOutcome reviewGame(const PgnGame& game, Engine::EngineSupervisor& engine, const ReviewOptions& opts, ReviewedGame& out) {
+    out = ReviewedGame();
+    out.id = game.id;
+    out.white = Chess::pgnTag(game.pgn, "White");
+    out.black = Chess::pgnTag(game.pgn, "Black");
+    out.result = Chess::pgnTag(game.pgn, "Result");
+
+    Chess::Board board;
+    bool parsed = board.loadPgn(game.pgn);
+    std::vector<Chess::Move> moves = board.getHistoryMoves();
+    if (!parsed || moves.empty()) return ReviewOutcome::Skipped;
+    board.reset();
+    std::string startFen = board.getFen();
+
+    std::vector<std::string> fens = {startFen};
+    for (const auto& m : moves) {
+        out.sanMoves.push_back(board.moveToSan(m));
+        out.uciMoves.push_back(m.toString());
+        board.makeMove(m);
+        fens.push_back(board.getFen());
+    }
+
+    // Every ply is sent as the start position plus the moves played, so the
+    // engine keeps its hash through the game
+    auto run = [&](const std::vector<size_t>& indices, const Engine::SearchLimits& limits,
+                   std::vector<Engine::EngineResult>& evals, const std::function<void(bool)>& done) {
+        for (size_t i : indices) {
+            std::vector<std::string> played(out.uciMoves.begin(), out.uciMoves.begin() + i);
+            done(engine.analyze(startFen, played, limits, evals[i]));
+        }
+    };
+
+    Chess::ReviewSettings settings;
+    settings.adaptive = opts.adaptive;
+    settings.depth = opts.limits.depth;
+    settings.nodes = opts.limits.nodes;
+    settings.movetime_ms = opts.limits.movetimeMs;
+    settings.node_budget = opts.nodeBudget;
+    settings.time_budget_ms = opts.timeBudgetMs;
+    settings.shallow_depth = opts.shallowDepth;
+    // The game already runs on a single engine: walk it in order
+    settings.single_session = true;
+    settings.reuse_best_move = opts.reuseBestMove;
+
+    Chess::GameReviewer reviewer;
+    std::vector<Engine::EngineResult> evals = reviewer.evaluatePositions(fens, out.uciMoves, settings, run, &out.stats);
+    if (out.stats.failed > 0) return ReviewOutcome::Failed;
+
+    out.reviews = reviewer.classifyGame(fens, evals, out.result);
+    out.report = Chess::ReviewReport::fromReviews(out.reviews);
+    return ReviewOutcome::Reviewed;
+}
+
+// Accuracy overall and per phase (null where the side made no move in it), plus error counts
+std::string sideJson(const Chess::ReviewReport::Side& side) {
+    std::string s = "{\"accuracy\":" + formatFloat(side.accuracy());
+    for (auto phase : {Chess::GamePhase::Opening, Chess::GamePhase::Middlegame, Chess::GamePhase::Endgame}) {
+        float acc = side.phaseAccuracy(phase);
+        s += ",\"" + std::string(Chess::phaseName(phase)) + "\":" + (acc < 0 ? "null" : formatFloat(acc));
+    }
+    return s + ",\"inaccuracies\":" + std::to_string(side.count(Chess::MoveClassification::Inaccuracy)) +
+           ",\"mistakes\":" + std::to_string(side.count(Chess::MoveClassification::Mistake)) +
+           ",\"blunders\":" + std::to_string(side.count(Chess::MoveClassification::Blunder)) + "}";
+}
+
+std::string toJsonLine(const ReviewedGame& g) {
+    std::string s = "{\"game\":" + jsonString(g.id) +
+                    ",\"white\":" + jsonString(g.white) +
+                    ",\"black\":" + jsonString(g.black) +
+                    ",\"result\":" + jsonString(g.result) +
+                    ",\"white_accuracy\":" + formatFloat(g.report.side(true).accuracy()) +
+                    ",\"black_accuracy\":" + formatFloat(g.report.side(false).accuracy()) +
+                    ",\"white_report\":" + sideJson(g.report.side(true)) +
+                    ",\"black_report\":" + sideJson(g.report.side(false)) +
+                    ",\"moves\":[";
+    for (size_t i = 0; i < g.reviews.size(); i++) {
+        const auto& r = g.reviews[i];
+        if (i) s += ',';
+        s += "{\"ply\":" + std::to_string(r.ply + 1) +
+             ",\"san\":" + jsonString(g.sanMoves[i]) +
+             ",\"uci\":" + jsonString(g.uciMoves[i]) +
+             ",\"best\":" + jsonString(r.best_move_uci) +
+             ",\"eval_before\":" + formatFloat(r.eval_before) +
+             ",\"eval_after\":" + formatFloat(r.eval_after) +
+             ",\"cp_loss\":" + formatFloat(r.cp_loss) +
+             ",\"win_loss\":" + formatFloat(r.win_loss) +
+             ",\"phase\":" + jsonString(Chess::phaseName(r.phase)) +
+             ",\"class\":" + jsonString(Chess::classificationName(r.classification)) + "}";
+    }
+    return s + "]}\n";
+}
+
+const char* CSV_HEADER = "game,white,black,result,ply,side,san,uci,best,eval_before,eval_after,cp_loss,win_loss,class,player_accuracy\n";
+
+std::string toCsvRows(const ReviewedGame& g) {
+    std::string s;
+    for (size_t i = 0; i < g.reviews.size(); i++) {
+        const auto& r = g.reviews[i];
+        bool white = (i % 2 == 0);
+        s += csvField(g.id) + ',' + csvField(g.white) + ',' + csvField(g.black) + ',' + csvField(g.result) + ',' +
+             std::to_string(r.ply + 1) + ',' + (white ? "w" : "b") + ',' +
+             csvField(g.sanMoves[i]) + ',' + g.uciMoves[i] + ',' + r.best_move_uci + ',' +
+             formatFloat(r.eval_before) + ',' + formatFloat(r.eval_after) + ',' + formatFloat(r.cp_loss) + ',' + formatFloat(r.win_loss) + ',' +
+             Chess::classificationName(r.classification) + ',' +
+             formatFloat(g.report.side(white).accuracy()) + '\n';
+    }
+    return s;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ReviewOptions opts;
+    try {
+        if (!parseArgs(argc, argv, opts)) {
+            printUsage();
+            return 2;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "chess-review: " << e.what() << std::endl;
+        printUsage();
+        return 2;
+    }
+
+    std::vector<PgnGame> allGames = loadGames(collectPgnFiles(opts.inputs));
+
+    if (opts.fresh) {
+        std::remove(opts.outPath.c_str());
+        std::remove(opts.checkpointPath.c_str());
+    }
+    std::set<std::string> finished = loadCheckpoint(opts.checkpointPath);
+    std::vector<PgnGame> games;
+    for (auto& g : allGames) {
+        if (!finished.count(g.id)) games.push_back(std::move(g));
+    }
+    std::cerr << allGames.size() << " games, " << finished.size() << " already reviewed, "
+              << games.size() << " to go" << std::endl;
+    if (games.empty()) return 0;
+
+    // Independent games: one search thread per engine scales best
+    Engine::EnginePool::Options poolOptions;
+    poolOptions.instances = opts.jobs;
+    poolOptions.totalThreads = opts.jobs;
+    if (opts.hashMb > 0) poolOptions.totalHashMb = opts.hashMb;
+    else poolOptions.totalHashMb = 16 * std::max(1, opts.jobs > 0 ? opts.jobs : (int)std::thread::hardware_concurrency());
+    Engine::EnginePool pool(opts.enginePath, poolOptions);
+    if (pool.start() == 0) {
+        std::cerr << "chess-review: could not start engine " << opts.enginePath << std::endl;
+        return 1;
+    }
+
+    bool writeHeader = opts.csv && (!fs::exists(opts.outPath) || fs::file_size(opts.outPath) == 0);
+    std::ofstream out(opts.outPath, std::ios::app | std::ios::binary);
+    std::ofstream checkpoint(opts.checkpointPath, std::ios::app);
+    if (!out || !checkpoint) {
+        std::cerr << "chess-review: cannot write " << opts.outPath << std::endl;
+        return 1;
+    }
+    if (writeHeader) out << CSV_HEADER;
+
+    std::mutex outputMutex;
+    size_t completed = 0;
+    size_t failed = 0;
+    size_t skipped = 0;
+    uint64_t totalNodes = 0;
+    int totalPositions = 0, totalSearches = 0, totalReused = 0;
+    auto t0 = std::chrono::steady_clock::now();
+
+    pool.forEach(games.size(), [&](Engine::EngineSupervisor& engine, size_t index) {
+        ReviewedGame reviewed;
+        ReviewOutcome outcome = reviewGame(games[index], engine, opts, reviewed);
+        if (outcome == ReviewOutcome::Skipped) {
+            std::lock_guard<std::mutex> lock(outputMutex);
+            skipped++;
+            std::cerr << "\nchess-review: no readable moves in game " << reviewed.id << ", skipped" << std::endl;
+            return;
+        }
+        if (outcome == ReviewOutcome::Failed) {
+            // Not checkpointed, so the next run retries it
+            std::lock_guard<std::mutex> lock(outputMutex);
+            failed++;
+            std::cerr << "\nchess-review: engine failed on game " << reviewed.id << ", skipped" << std::endl;
+            return;
+        }
+        std::string text = opts.csv ? toCsvRows(reviewed) : toJsonLine(reviewed);
+
+        std::lock_guard<std::mutex> lock(outputMutex);
+        // Output first: a game is only marked done once its rows are on disk
+        out << text;
+        out.flush();
+        checkpoint << reviewed.id << '\n';
+        checkpoint.flush();
+
+        completed++;
+        totalNodes += reviewed.stats.nodes;
+        totalPositions += reviewed.stats.positions;
+        totalSearches += reviewed.stats.shallow_searches + reviewed.stats.deep_searches;
+        totalReused += reviewed.stats.reused;
+        double hours = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() / 3600.0;
+        std::cerr << "\r[" << completed + failed + skipped << "/" << games.size() << "] "
+                  << (int)(hours > 0 ? completed / hours : 0) << " games/hour" << std::flush;
+    });
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::cerr << "\nReviewed " << completed << " games in " << (int)seconds << "s ("
+              << (int)(seconds > 0 ? completed * 3600.0 / seconds : 0) << " games/hour) with "
+              << pool.size() << " engines" << std::endl;
+    if (skipped > 0) std::cerr << skipped << " games skipped: empty or unreadable movetext" << std::endl;
+    if (failed > 0) std::cerr << failed << " games failed and will be retried on the next run" << std::endl;
+    std::cerr << totalSearches << " searches for " << totalPositions << " positions ("
+              << totalReused << " taken from the previous PV), " << totalNodes << " nodes" << std::endl;
+    pool.stop();
+    return failed > 0 ? 1 : 0;
+}
@@ -1,8 +1,23 @@
 #include "../src/core/board.hpp"
 #include "../src/core/types.hpp"
 #include "../src/core/game_record.hpp"
+#include "../src/core/pgn.hpp"
 #include "../src/engine/stockfish.hpp"
 #include "../src/engine/game_reviewer.hpp"
+#include "../src/engine/analysis_cache.hpp"
+#include "../src/engine/analysis_scheduler.hpp"
+#include "../src/engine/engine_supervisor.hpp"
+#include "../src/engine/engine_pool.hpp"
+#include "../src/engine/review_store.hpp"
+#include "../src/engine/review_scheduler.hpp"
+#include "../src/gui/app_model.hpp"
+#include "../src/gui/frame_profiler.hpp"
+#include "../src/gui/layout_geometry.hpp"
+#include "../src/gui/snapshot_channel.hpp"
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
 #include <cassert>
 #include <chrono>
@@ -13,9 +28,19 @@ using namespace Chess;
 
 #define EXPECT_TRUE(cond) if (!(cond)) { std::cerr << "FAIL: " << #cond << " at " << __LINE__ << std::endl; exit(1); }
 #define EXPECT_FALSE(cond) if (cond) { std::cerr << "FAIL: " << #cond << " at " << __LINE__ << std::endl; exit(1); }
+// Sizes are compared against plain int literals, so integers meet as signed
+template<typename T1, typename T2>
+bool values_equal(const T1& a, const T2& b) {
+    if constexpr (std::is_integral_v<T1> && std::is_integral_v<T2>) {
+        return static_cast<long long>(a) == static_cast<long long>(b);
+    } else {
+        return a == b;
+    }
+}
+
 template<typename T1, typename T2>
 void expect_eq(const T1& a, const T2& b, const char* a_str, const char* b_str, int line) {
-    if (a != b) {
+    if (!values_equal(a, b)) {
         std::cerr << "FAIL: " << a_str << " != " << b_str;
         if constexpr (std::is_enum_v<T1> || std::is_integral_v<T1>) {
             std::cerr << " (" << static_cast<long long>(a);
@@ -173,11 +198,56 @@ void test_addMove() {
     EXPECT_EQ(gr.sanMoves[1], "d4");
 }
 
+void test_getMoveStrings() {
+    GameRecord gr;
+    Board b;
+    b.reset();
+    std::string start = b.getFen();
+    for (const char* san : {"e4", "e5", "Nf3"}) {
+        Move m = b.parseSan(san);
+        gr.addMove(m, san);
+        b.makeMove(m);
+    }
+    gr.prev();
+    auto uci = gr.getMoveStrings();
+    EXPECT_EQ(uci.size(), 2);
+    EXPECT_EQ(uci[1], "e7e5");
+
+    // Replaying the moves from the start FEN reaches the same position
+    b.undoMove();
+    EXPECT_EQ(Engine::applyUciMoves(start, uci), b.getFen());
+}
+
 void test_loadPgn() {
     Board b;
     std::string pgn = "1. e4 e5 2. Nf3 Nc6 3. Bc4 Bc5";
-    b.loadPgn(pgn);
+    EXPECT_TRUE(b.loadPgn(pgn));
     EXPECT_EQ(b.getFen(), "r1bqk1nr/pppp1ppp/2n5/2b1p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4");
+
+    // Annotations are not moves
+    EXPECT_TRUE(b.loadPgn("1. e4! $1 e5?! 2. Nf3 {best} Nc6 1-0"));
+    EXPECT_EQ(b.getHistoryMoves().size(), 4);
+
+    // A move that doesn't parse is reported
+    EXPECT_FALSE(b.loadPgn("1. e4 e5 2. Ke3 Nc6"));
+    EXPECT_TRUE(b.loadPgn(""));
+    EXPECT_TRUE(b.getHistoryMoves().empty());
+}
+
+void test_pgn_split_and_tags() {
+    std::string db =
+        "[Event \"A\"]\n[White \"Alice\"]\n[Result \"1-0\"]\n\n1. e4 e5 2. Qh5 Nc6 1-0\n\n"
+        "[Event \"B\"]\r\n[Result \"1/2-1/2\"]\r\n\r\n1. d4 d5 1/2-1/2\r\n";
+    auto games = splitPgnGames(db);
+    EXPECT_EQ(games.size(), 2);
+    EXPECT_EQ(pgnTag(games[0], "White"), "Alice");
+    EXPECT_EQ(pgnTag(games[0], "Result"), "1-0");
+    EXPECT_EQ(pgnTag(games[1], "Result"), "1/2-1/2");
+    EXPECT_EQ(pgnTag(games[1], "White"), "");
+
+    // Bare movetext is a single game
+    EXPECT_EQ(splitPgnGames("1. e4 e5 2. Nf3").size(), 1);
+    EXPECT_EQ(splitPgnGames("\n\n").size(), 0);
 }
 
 void test_stockfish_integration() {
@@ -223,6 +293,322 @@ void test_game_reviewer_classification() {
     EXPECT_EQ(gr.classifyMove(50.0f, -400.0f), MoveClassification::Good);
 }
 
+void test_game_reviewer_classify_game() {
+    GameReviewer gr;
+    std::vector<std::string> fens = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+        "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2"
+    };
+    // Side-to-move scores: +30 for White, then -30 and -280 for Black
+    std::vector<Engine::EngineResult> evals(3);
+    evals[0].centipawns = 30.0f;  evals[0].best_move = "e2e4";
+    evals[1].centipawns = -30.0f; evals[1].best_move = "c7c5";
+    evals[2].centipawns = 280.0f;
+
+    auto reviews = gr.classifyGame(fens, evals);
+    EXPECT_EQ(reviews.size(), 2);
+    EXPECT_EQ(reviews[0].classification, MoveClassification::Best);
+    EXPECT_EQ(reviews[0].eval_after, 30.0f);
+    EXPECT_EQ(reviews[1].best_move_uci, "c7c5");
+    EXPECT_EQ(reviews[1].cp_loss, 250.0f);
+    EXPECT_EQ(reviews[1].classification, MoveClassification::Blunder);
+}
+
+void test_game_reviewer_win_probability() {
+    // 100 cp is normalized to a 50% win at any material
+    EXPECT_TRUE(std::fabs(winRate(100.0f, 58) - 500.0f) < 1.0f);
+    EXPECT_TRUE(std::fabs(expectedScore(0.0f, false, 78) - 50.0f) < 0.01f);
+    EXPECT_TRUE(expectedScore(200.0f, false, 78) > expectedScore(50.0f, false, 78));
+    EXPECT_EQ(expectedScore(29990.0f, true, 40), 100.0f);
+    EXPECT_EQ(materialCount("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"), 78);
+    EXPECT_EQ(classifyWinLoss(0.5f), MoveClassification::Best);
+    EXPECT_EQ(classifyWinLoss(12.0f), MoveClassification::Mistake);
+
+    GameReviewer gr;
+    // Only move: the second line gives the advantage away
+    std::vector<std::string> fens = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1"
+    };
+    std::vector<Engine::EngineResult> evals(2);
+    evals[0].centipawns = 100.0f;
+    evals[0].lines = {{"e2e4", 100.0f, 100, false, 20}, {"g1f3", -100.0f, -100, false, 20}};
+    evals[1].centipawns = -100.0f;
+    EXPECT_EQ(gr.classifyGame(fens, evals)[0].classification, MoveClassification::Great);
+    evals[0].lines[1].centipawns = 95.0f;
+    EXPECT_EQ(gr.classifyGame(fens, evals)[0].classification, MoveClassification::Best);
+
+    // Brilliant: Ne5 puts the knight en prise and the engine still likes it
+    std::vector<std::string> sac = {
+        "4k3/8/3p4/8/8/5N2/8/4K3 w - - 0 1",
+        "4k3/8/3p4/4N3/8/8/8/4K3 b - - 1 1"
+    };
+    evals[0] = {};
+    evals[0].centipawns = 50.0f;
+    evals[1] = {};
+    evals[1].centipawns = -150.0f;
+    evals[1].best_move = "d6e5";
+    auto reviews = gr.classifyGame(sac, evals);
+    EXPECT_EQ(reviews[0].classification, MoveClassification::Brilliant);
+    EXPECT_EQ(reviews[0].win_loss, 0.0f);
+}
+
+void test_game_reviewer_live_review() {
+    GameReviewer gr;
+    std::vector<std::string> fens = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+        "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2"
+    };
+    // No engine running: the worker stops, failed, with every ply still pending
+    Engine::EnginePool pool("missing-engine.exe");
+    gr.startReview(fens, {"e2e4", "e7e5"}, pool);
+    gr.cancel();
+    gr.startReview(fens, {"e2e4", "e7e5"}, pool);
+    for (int i = 0; i < 200 && gr.isRunning(); i++) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    auto snap = gr.snapshot();
+    EXPECT_FALSE(snap.complete);
+    EXPECT_TRUE(snap.failed);
+    EXPECT_FALSE(snap.running);
+    EXPECT_EQ(snap.results->size(), 2);
+    EXPECT_FALSE((*snap.results)[0].ready);
+    EXPECT_TRUE(snap.progress < 1.0f);
+    gr.cancel();
+    gr.cancel();
+
+    // Pending plies are left out of the summary
+    std::vector<MoveReview> partial = gr.getResults();
+    partial[0].cp_loss = 300.0f;
+    partial[0].classification = MoveClassification::Blunder;
+    partial[0].ready = false;
+    EXPECT_EQ(computeSummary(partial, true).blunders, 0);
+}
+
+void test_game_reviewer_adaptive() {
+    GameReviewer gr;
+    std::vector<std::string> fens = {
+        "k7/8/8/8/8/8/1R6/K7 b - - 0 1",     // only Ka7 is legal
+        "8/k7/8/8/8/8/1R6/K7 w - - 1 2",
+        "8/k7/8/8/8/1R6/8/K7 b - - 2 2"
+    };
+    std::vector<std::pair<size_t, int>> searched;
+    auto run = [&](const std::vector<size_t>& indices, const Engine::SearchLimits& limits,
+                   std::vector<Engine::EngineResult>& evals, const std::function<void(bool)>& done) {
+        for (size_t i : indices) {
+            searched.push_back({i, limits.depth});
+            Engine::EngineResult r;
+            r.depth = limits.depth;
+            r.nodes = 100;
+            r.centipawns = (i == 1) ? 500.0f : -520.0f;
+            if (i == 1) {
+                // Two moves of almost equal value: worth a deeper look
+                r.lines = {{"b2b3", 500.0f, 500, false, limits.depth}, {"b2c2", 490.0f, 490, false, limits.depth}};
+            }
+            evals[i] = r;
+            done(true);
+        }
+    };
+
+    ReviewSettings settings;
+    settings.adaptive = true;
+    settings.shallow_depth = 8;
+    settings.depth = 16;
+    ReviewStats stats;
+    float last_progress = 0.0f;
+    auto evals = gr.evaluatePositions(fens, {}, settings, run, &stats, [&](float p) { last_progress = p; });
+
+    EXPECT_EQ(stats.forced_skipped, 1);
+    EXPECT_EQ(stats.shallow_searches, 2);
+    EXPECT_EQ(stats.deep_searches, 1);
+    EXPECT_EQ(stats.nodes, 300);
+    EXPECT_EQ(searched.size(), 3);
+    EXPECT_TRUE(searched[2].first == 1 && searched[2].second == 16);
+    EXPECT_EQ(last_progress, 1.0f);
+
+    // The forced move takes the eval of the position it leads to
+    EXPECT_EQ(evals[0].best_move, "a8a7");
+    EXPECT_EQ(evals[0].centipawns, -500.0f);
+    EXPECT_EQ(gr.classifyGame(fens, evals)[0].classification, MoveClassification::Best);
+
+    // Flat mode searches everything once
+    searched.clear();
+    settings.adaptive = false;
+    gr.evaluatePositions(fens, {}, settings, run, &stats);
+    EXPECT_EQ(searched.size(), 3);
+    EXPECT_EQ(stats.deep_searches, 3);
+}
+
+void test_game_reviewer_reuse_best_move() {
+    GameReviewer gr;
+    std::vector<std::string> fens = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+        "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+        "rnbqkbnr/pppp1ppp/8/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2"
+    };
+    std::vector<std::string> moves = {"e2e4", "e7e5", "g1f3"};
+    std::vector<size_t> order;
+    std::vector<std::string> first_pv = {"e2e4", "c7c5", "g1f3"};
+    auto run = [&](const std::vector<size_t>& indices, const Engine::SearchLimits&,
+                   std::vector<Engine::EngineResult>& evals, const std::function<void(bool)>& done) {
+        for (size_t i : indices) {
+            order.push_back(i);
+            Engine::EngineResult r;
+            r.depth = 18;
+            r.centipawns = 30.0f;
+            // Position 2 expects 2.Nc3 instead of Nf3
+            if (i == 0) r.pv = first_pv;
+            if (i == 1) {
+                // Anything but e5 loses
+                r.pv = {"e7e5", "g1f3"};
+                r.lines = {{"e7e5", 30.0f, 30, false, 18}, {"d7d5", -400.0f, -400, false, 18}};
+            }
+            if (i == 2) {
+                r.centipawns = -30.0f;
+                r.pv = {"b1c3", "g8f6"};
+            }
+            if (i == 3) r.pv = {"b8c6"};
+            if (!r.pv.empty()) r.best_move = r.pv[0];
+            evals[i] = r;
+            done(true);
+        }
+    };
+
+    ReviewSettings settings;
+    settings.single_session = true;
+    ReviewStats stats;
+    auto evals = gr.evaluatePositions(fens, moves, settings, run, &stats);
+
+    // Position 0 expects 1.e4 c5: after 1.e4 the position comes from its PV,
+    // and 1...e5 left the PV, so it can't have been an only move. Position 2
+    // is searched because 1 was not.
+    EXPECT_EQ(order.size(), 3);
+    EXPECT_EQ(order[0], 0);
+    EXPECT_EQ(order[1], 2);
+    EXPECT_EQ(order[2], 3);
+    EXPECT_EQ(stats.reused, 1);
+    EXPECT_EQ(stats.deep_searches, 3);
+    EXPECT_EQ(evals[1].centipawns, -30.0f);
+    EXPECT_EQ(evals[1].best_move, "c7c5");
+
+    // When the reply follows the PV too, its position is searched for the
+    // second line that shows 1...e5 as the only move
+    first_pv = {"e2e4", "e7e5", "g1f3"};
+    order.clear();
+    evals = gr.evaluatePositions(fens, moves, settings, run, &stats);
+    EXPECT_EQ(order.size(), 4);
+    EXPECT_EQ(order[1], 1);
+    EXPECT_EQ(stats.reused, 0);
+    EXPECT_EQ(evals[1].lines.size(), 2);
+    auto reviews = gr.classifyGame(fens, evals);
+    EXPECT_TRUE(reviews[1].classification == MoveClassification::Great);
+
+    order.clear();
+    settings.reuse_best_move = false;
+    gr.evaluatePositions(fens, moves, settings, run, &stats);
+    EXPECT_EQ(order.size(), 4);
+    EXPECT_EQ(stats.reused, 0);
+}
+
+void test_game_reviewer_node_budget() {
+    GameReviewer gr;
+    std::vector<std::string> fens = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+        "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+        "rnbqkbnr/pppp1ppp/8/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2"
+    };
+    std::vector<std::string> moves = {"e2e4", "e7e5", "g1f3"};
+    std::vector<Engine::SearchLimits> seen;
+    auto run = [&](const std::vector<size_t>& indices, const Engine::SearchLimits& limits,
+                   std::vector<Engine::EngineResult>& evals, const std::function<void(bool)>& done) {
+        for (size_t i : indices) {
+            seen.push_back(limits);
+            evals[i].nodes = limits.nodes;
+            evals[i].depth = 12;
+            // The engine's move is played after position 0 only, and the
+            // reply leaves its PV
+            evals[i].best_move = (i == 0) ? "e2e4" : "a2a3";
+            evals[i].pv = {evals[i].best_move, "c7c5"};
+            done(true);
+        }
+    };
+
+    // Spread evenly, nodes only
+    ReviewSettings settings;
+    settings.node_budget = 400000;
+    ReviewStats stats;
+    gr.evaluatePositions(fens, moves, settings, run, &stats);
+    EXPECT_EQ(seen.size(), 4);
+    EXPECT_EQ(seen[0].nodes, 100000);
+    EXPECT_EQ(seen[0].depth, 0);
+    EXPECT_EQ(stats.nodes, 400000);
+
+    // Walking the game: the reused position's share goes to the ones after
+    seen.clear();
+    settings.single_session = true;
+    gr.evaluatePositions(fens, moves, settings, run, &stats);
+    EXPECT_EQ(stats.reused, 1);
+    EXPECT_EQ(seen.size(), 3);
+    EXPECT_EQ(seen[0].nodes, 100000);
+    EXPECT_EQ(seen[1].nodes, 150000);
+    EXPECT_EQ(seen[2].nodes, 150000);
+    EXPECT_EQ(stats.nodes, 400000);
+}
+
+void test_review_report() {
+    EXPECT_TRUE(gamePhase("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1") == GamePhase::Opening);
+    // Castled, rooks connected: back rank thinned out
+    EXPECT_TRUE(gamePhase("r2q1rk1/ppp2ppp/2n2n2/3pp3/3PP3/2N2N2/PPP2PPP/R2Q1RK1 w - - 0 9") == GamePhase::Middlegame);
+    EXPECT_TRUE(gamePhase("4k3/8/8/3r4/8/2B5/5PPP/4R1K1 w - - 0 40") == GamePhase::Endgame);
+
+    auto review = [](int ply, MoveClassification c, float win_loss, GamePhase phase) {
+        MoveReview r = {ply, 0.0f, 0.0f, 0.0f, "", c};
+        r.win_loss = win_loss;
+        r.phase = phase;
+        return r;
+    };
+    std::vector<MoveReview> reviews = {
+        review(0, MoveClassification::Best, 0.0f, GamePhase::Opening),
+        review(1, MoveClassification::Blunder, 30.0f, GamePhase::Opening),
+        review(2, MoveClassification::Inaccuracy, 6.0f, GamePhase::Middlegame),
+        review(3, MoveClassification::Good, 2.0f, GamePhase::Middlegame)
+    };
+
+    // Filled in one ply at a time, out of order, as a live review does
+    ReviewReport live(reviews.size());
+    MoveReview pending = reviews[2];
+    pending.ready = false;
+    live.set(pending);
+    live.set(reviews[3]);
+    live.set(reviews[0]);
+    EXPECT_EQ(live.pliesDone(), 2);
+    EXPECT_EQ(live.side(true).moves, 1);
+    live.set(reviews[1]);
+    live.set(reviews[2]);
+    // Replacing a ply takes its old grade out first
+    live.set(reviews[2]);
+
+    ReviewReport full = ReviewReport::fromReviews(reviews);
+    EXPECT_EQ(live.pliesDone(), 4);
+    EXPECT_EQ(live.side(true).moves, 2);
+    EXPECT_EQ(live.side(true).count(MoveClassification::Inaccuracy), 1);
+    EXPECT_EQ(live.side(false).count(MoveClassification::Blunder), 1);
+    // Every class has a count, the last included
+    EXPECT_EQ(live.side(true).count(MoveClassification::GameEnd), 0);
+    EXPECT_TRUE(std::fabs(live.side(true).accuracy() - full.side(true).accuracy()) < 0.001f);
+    EXPECT_TRUE(std::fabs(live.side(false).accuracy() - full.side(false).accuracy()) < 0.001f);
+    EXPECT_TRUE(std::fabs(full.side(true).phaseAccuracy(GamePhase::Opening) - moveAccuracy(0.0f)) < 0.001f);
+    EXPECT_TRUE(std::fabs(full.side(false).phaseAccuracy(GamePhase::Middlegame) - moveAccuracy(2.0f)) < 0.001f);
+    EXPECT_TRUE(full.side(true).phaseAccuracy(GamePhase::Endgame) < 0.0f);
+    EXPECT_TRUE(full.timeline()[1].ready);
+
+    ReviewSummary black = full.side(false).summary();
+    EXPECT_EQ(black.blunders, 1);
+    EXPECT_EQ(black.good_moves, 1);
+}
+
 void test_game_reviewer_summary() {
     std::vector<MoveReview> reviews;
     // White moves at even ply: 0, 2
@@ -235,6 +621,7 @@ void test_game_reviewer_summary() {
     EXPECT_EQ(white_summary.mistakes, 1);
     EXPECT_EQ(white_summary.good_moves, 1); // Best is categorized under good_moves in computeSummary
     EXPECT_EQ(white_summary.blunders, 0);
+    EXPECT_TRUE(white_summary.accuracy > 99.9f); // win_loss not set: no expected score lost
 
     ReviewSummary black_summary = computeSummary(reviews, false);
     EXPECT_EQ(black_summary.good_moves, 1);
@@ -242,6 +629,842 @@ void test_game_reviewer_summary() {
     // GameEnd should be skipped
 }
 
+void test_game_reviewer_search_failure() {
+    GameReviewer gr;
+    std::vector<std::string> fens = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+        "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2"
+    };
+    // The engine gives up on the second position
+    int searches = 0;
+    auto run = [&](const std::vector<size_t>& indices, const Engine::SearchLimits& limits,
+                   std::vector<Engine::EngineResult>& evals, const std::function<void(bool)>& done) {
+        for (size_t i : indices) {
+            searches++;
+            if (i == 1) {
+                done(false);
+                continue;
+            }
+            evals[i].depth = limits.depth;
+            evals[i].best_move = "e2e4";
+            done(true);
+        }
+    };
+
+    // Adaptive reviews stop after the failed pass instead of deepening
+    ReviewSettings settings;
+    settings.adaptive = true;
+    ReviewStats stats;
+    auto evals = gr.evaluatePositions(fens, {"e2e4", "e7e5"}, settings, run, &stats);
+    EXPECT_EQ(stats.failed, 1);
+    EXPECT_EQ(stats.deep_searches, 0);
+    EXPECT_EQ(evals[1].depth, 0);
+
+    // A walk stops at the failed position
+    searches = 0;
+    settings.adaptive = false;
+    settings.single_session = true;
+    gr.evaluatePositions(fens, {"e2e4", "e7e5"}, settings, run, &stats);
+    EXPECT_EQ(stats.failed, 1);
+    EXPECT_EQ(searches, 2);
+}
+
+void test_parse_info_line() {
+    Engine::EngineResult info;
+    EXPECT_TRUE(Engine::parseInfoLine("info depth 12 seldepth 18 multipv 1 score cp -45 lowerbound wdl 40 600 360 nodes 1000 pv d7d5 e4d5 d8d5", info));
+    EXPECT_EQ(info.depth, 12);
+    EXPECT_EQ(info.score, -45);
+    EXPECT_FALSE(info.is_mate);
+    EXPECT_TRUE(info.bound == Engine::ScoreBound::Lower);
+    EXPECT_EQ(info.wdl[2], 360);
+    EXPECT_EQ(info.pv.size(), 3);
+    EXPECT_EQ(info.best_move, "d7d5");
+    EXPECT_EQ(info.nodes, 1000);
+
+    Engine::EngineResult mate;
+    EXPECT_TRUE(Engine::parseInfoLine("info depth 30 score mate -3 pv e1e2", mate));
+    EXPECT_TRUE(mate.is_mate);
+    EXPECT_EQ(Engine::formatScore(mate), "#-3");
+
+    Engine::EngineResult none;
+    EXPECT_FALSE(Engine::parseInfoLine("info string NNUE evaluation enabled", none));
+}
+
+void test_analysis_cache() {
+    Engine::AnalysisCache cache(2);
+    uint64_t k1 = Engine::positionKey("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    uint64_t k2 = Engine::positionKey("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1");
+    uint64_t k3 = Engine::positionKey("rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2");
+    // The fullmove number does not change the key, the halfmove clock does:
+    // scores drift towards the 50-move rule
+    EXPECT_EQ(k1, Engine::positionKey("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 40"));
+    EXPECT_TRUE(k1 != Engine::positionKey("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 90 40"));
+
+    // A history that repeats a position may be scored as a draw: not cacheable
+    std::string start = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    EXPECT_EQ(Engine::historyKey(start, {}), k1);
+    EXPECT_EQ(Engine::historyKey(start, {"e2e4"}), Engine::positionKey(Engine::applyUciMoves(start, {"e2e4"})));
+    EXPECT_EQ(Engine::historyKey(start, {"g1f3", "g8f6", "f3g1", "f6g8"}), 0u);
+    EXPECT_EQ(Engine::historyKey(start, {"g1f3", "g8f6", "f3g1", "f6g8", "e2e4"}), 0u);
+    EXPECT_TRUE(Engine::historyKey(start, {"g1f3", "g8f6", "f3g1", "b8c6"}) != 0);
+
+    // Each MultiPV setting has its own entries
+    EXPECT_EQ(Engine::searchKey(k1, 1), k1);
+    EXPECT_TRUE(Engine::searchKey(k1, 3) != k1);
+    EXPECT_TRUE(Engine::searchKey(k1, 3) != Engine::searchKey(k1, 2));
+    EXPECT_EQ(Engine::searchKey(0, 3), 0u);
+
+    Engine::EngineResult r;
+    r.depth = 18; r.score = 35; r.wdl[0] = 100; r.pv = {"e2e4", "e7e5", "g1f3"};
+    cache.store(k1, r);
+
+    Engine::EngineResult out;
+    EXPECT_TRUE(cache.lookup(k1, 18, out));
+    EXPECT_EQ(out.score, 35);
+    EXPECT_EQ(out.best_move, "e2e4");
+    EXPECT_EQ(out.pv.size(), 3);
+    EXPECT_FALSE(cache.lookup(k1, 20, out)); // Not deep enough
+
+    // Shallower results never replace deeper ones
+    Engine::EngineResult shallow;
+    shallow.depth = 5; shallow.score = -10;
+    cache.store(k1, shallow);
+    EXPECT_TRUE(cache.lookup(k1, 18, out));
+
+    // LRU: k1 was just used, so k2 gets evicted by k3
+    cache.store(k2, shallow);
+    cache.lookup(k1, 0, out);
+    cache.store(k3, shallow);
+    EXPECT_EQ(cache.size(), 2);
+    EXPECT_FALSE(cache.lookup(k2, 0, out));
+    EXPECT_TRUE(cache.lookup(k3, 0, out));
+
+    // Round trip through the mapped file
+    std::string path = "analysis_cache_test.bin";
+    EXPECT_TRUE(cache.save(path));
+    Engine::AnalysisCache reloaded(2);
+    EXPECT_TRUE(reloaded.load(path));
+    EXPECT_EQ(reloaded.size(), 2);
+    EXPECT_TRUE(reloaded.lookup(k1, 18, out));
+    EXPECT_EQ(out.pv[2], "g1f3");
+    EXPECT_EQ(out.wdl[0], 100);
+    std::remove(path.c_str());
+
+    // MultiPV lines are stored with their scores and PVs
+    Engine::EngineResult multi = r;
+    multi.lines = {{"e2e4", 35.0f, 35, false, 18, {"e2e4", "e7e5"}},
+                   {"d2d4", 20.0f, 20, false, 18, {"d2d4", "d7d5", "c2c4"}},
+                   {"g1f3", 0.0f, 3, true, 17, {"g1f3"}}};
+    uint64_t k4 = Engine::searchKey(k1, 3);
+    reloaded.store(k4, multi);
+    EXPECT_TRUE(reloaded.save(path));
+    Engine::AnalysisCache withLines;
+    EXPECT_TRUE(withLines.load(path));
+    EXPECT_TRUE(withLines.lookup(k4, 18, out));
+    EXPECT_EQ(out.lines.size(), 3);
+    EXPECT_EQ(out.lines[0].move, "e2e4");
+    EXPECT_EQ(out.lines[1].score, 20);
+    EXPECT_EQ(out.lines[1].pv.size(), 3);
+    EXPECT_EQ(out.lines[1].pv[2], "c2c4");
+    EXPECT_TRUE(out.lines[2].is_mate);
+    EXPECT_EQ(out.lines[2].depth, 17);
+    EXPECT_EQ(out.lines[2].move, "g1f3");
+    std::remove(path.c_str());
+
+    // More lines than a record holds are not stored
+    multi.lines.resize(Engine::CacheRecord::MAX_LINES + 1);
+    withLines.store(Engine::searchKey(k1, 5), multi);
+    EXPECT_FALSE(withLines.lookup(Engine::searchKey(k1, 5), 0, out));
+}
+
+void test_review_store() {
+    std::string start = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    uint64_t key = gameKey(start, {"e2e4", "e7e5"});
+    EXPECT_TRUE(key != gameKey(start, {"e2e4", "c7c5"}));
+    EXPECT_TRUE(key != gameKey(start, {"e2e4e7e5"}));
+
+    StoredReview review;
+    review.engine = "Stockfish 17";
+    review.depth = 18;
+    review.settings = settingsFingerprint(ReviewSettings{});
+    review.evals.resize(3);
+    review.evals[0].score = 30;
+    review.evals[0].centipawns = 30.0f;
+    review.evals[0].depth = 18;
+    review.evals[0].best_move = "e2e4";
+    review.evals[0].lines = {{"e2e4", 30.0f, 30, false, 18}, {"d2d4", 25.0f, 25, false, 18}};
+    review.evals[1].score = 3;
+    review.evals[1].is_mate = true;
+    review.evals[1].depth = 10;
+    review.evals[2].depth = 18;
+
+    ReviewStore store("review_store_test");
+    EXPECT_TRUE(store.save(key, review));
+    StoredReview loaded;
+    EXPECT_TRUE(store.load(key, loaded));
+    StoredReview missing;
+    EXPECT_FALSE(store.load(key + 1, missing));
+    EXPECT_EQ(loaded.engine, "Stockfish 17");
+    EXPECT_EQ(loaded.settings, review.settings);
+    EXPECT_EQ(loaded.evals.size(), 3);
+    EXPECT_EQ(loaded.evals[0].best_move, "e2e4");
+    EXPECT_EQ(loaded.evals[0].lines.size(), 2);
+    EXPECT_EQ(loaded.evals[0].lines[1].move, "d2d4");
+    EXPECT_EQ(loaded.evals[1].centipawns, 29997.0f);
+
+    // Incremental re-review: only the position without a usable depth is searched
+    std::vector<std::string> fens = {start,
+        "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1",
+        "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2"};
+    std::vector<size_t> searched;
+    auto run = [&](const std::vector<size_t>& indices, const Engine::SearchLimits& limits,
+                   std::vector<Engine::EngineResult>& evals, const std::function<void(bool)>& done) {
+        for (size_t i : indices) {
+            searched.push_back(i);
+            evals[i].depth = limits.depth;
+            done(true);
+        }
+    };
+    loaded.evals[1].depth = 0;
+    GameReviewer gr;
+    ReviewStats stats;
+    gr.evaluatePositions(fens, {"e2e4", "e7e5"}, ReviewSettings{}, run, &stats, nullptr, loaded.evals);
+    EXPECT_EQ(searched.size(), 1);
+    EXPECT_EQ(searched[0], 1);
+    EXPECT_EQ(stats.stored, 2);
+
+    // Under the settings it was made with, an adaptive review is reused
+    // whole, shallow plies included
+    ReviewSettings adaptive;
+    adaptive.adaptive = true;
+    StoredReview shallow = review;
+    shallow.settings = settingsFingerprint(adaptive);
+    auto reused = reusableEvals(shallow, adaptive);
+    EXPECT_EQ(reused[0].depth, 18);
+    EXPECT_EQ(reused[1].depth, 10);
+    // Other settings take only what is deep enough for them
+    adaptive.depth = 20;
+    reused = reusableEvals(shallow, adaptive);
+    EXPECT_EQ(reused[0].depth, 0);
+    adaptive.depth = 18;
+    adaptive.shallow_depth = 12;
+    reused = reusableEvals(shallow, adaptive);
+    EXPECT_EQ(reused[0].depth, 18);
+    EXPECT_EQ(reused[1].depth, 0);
+    // Node limits say nothing about depth: nothing from other settings counts
+    adaptive.node_budget = 1000000;
+    reused = reusableEvals(shallow, adaptive);
+    EXPECT_EQ(reused[0].depth, 0);
+
+    // Only records with every position searched, under a named engine, are
+    // shown again
+    gr.setStore(&store);
+    EXPECT_TRUE(gr.restoreReview(fens, {"e2e4", "e7e5"}));
+    EXPECT_TRUE(gr.snapshot().complete);
+    review.evals[1].depth = 0;
+    EXPECT_TRUE(store.save(key, review));
+    EXPECT_FALSE(gr.restoreReview(fens, {"e2e4", "e7e5"}));
+    review.evals[1].depth = 10;
+    review.engine = "";
+    EXPECT_TRUE(store.save(key, review));
+    EXPECT_FALSE(gr.restoreReview(fens, {"e2e4", "e7e5"}));
+
+    // A mated position is searched to depth 0
+    std::vector<std::string> mate = {"rnbqkbnr/pppp1ppp/8/4p3/6P1/5P2/PPPPP2P/RNBQKBNR b KQkq - 0 2",
+                                     "rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3"};
+    uint64_t mate_key = gameKey(mate[0], {"d8h4"});
+    StoredReview mated;
+    mated.engine = "Stockfish 17";
+    mated.evals.resize(2);
+    mated.evals[0].depth = 18;
+    EXPECT_TRUE(store.save(mate_key, mated));
+    EXPECT_TRUE(gr.restoreReview(mate, {"d8h4"}));
+
+    std::filesystem::remove_all("review_store_test");
+}
+
+void test_review_scheduler() {
+    std::string bulk_start = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    std::string live_start = "4k3/8/8/8/8/8/4P3/4K3 w - - 0 1";
+    std::vector<std::string> bulk_fens(6, bulk_start), live_fens(3, live_start);
+
+    std::mutex order_mutex;
+    std::vector<std::string> order;
+    auto search = [&](size_t, const std::string& start_fen, const std::vector<std::string>&,
+                      const Engine::SearchLimits&, Engine::EngineResult& out) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        out.depth = 18;
+        out.nodes = 1000;
+        std::lock_guard<std::mutex> lock(order_mutex);
+        order.push_back(start_fen);
+        return true;
+    };
+
+    // One engine: the interactive job overtakes the bulk one already running
+    ReviewScheduler::Options opts;
+    opts.max_running_bulk = 1;
+    ReviewScheduler scheduler(1, search, opts);
+    EXPECT_EQ(scheduler.start(), 1);
+    uint64_t bulk = scheduler.submit("bulk", ReviewPriority::Bulk, bulk_fens, {});
+    uint64_t queued = scheduler.submit("bulk", ReviewPriority::Bulk, bulk_fens, {});
+    std::this_thread::sleep_for(std::chrono::milliseconds(15));
+    uint64_t live = scheduler.submit("alice", ReviewPriority::Interactive, live_fens, {});
+    EXPECT_TRUE(scheduler.cancel(queued));
+
+    ReviewJobStatus st;
+    for (int i = 0; i < 400; i++) {
+        EXPECT_TRUE(scheduler.status(bulk, st));
+        if (st.state == ReviewJobState::Done) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(st.state, ReviewJobState::Done);
+    EXPECT_EQ(st.results.size(), 5);
+    EXPECT_EQ(st.nodes, 6000);
+    EXPECT_TRUE(scheduler.status(live, st));
+    EXPECT_EQ(st.state, ReviewJobState::Done);
+    EXPECT_TRUE(scheduler.status(queued, st));
+    EXPECT_EQ(st.state, ReviewJobState::Cancelled);
+
+    // Once its searches are queued they all run before the next bulk one
+    size_t first_live = std::find(order.begin(), order.end(), live_start) - order.begin();
+    EXPECT_EQ(order.size(), 9);
+    EXPECT_TRUE(first_live < 6);
+    EXPECT_TRUE(order[first_live + 1] == live_start && order[first_live + 2] == live_start);
+
+    auto m = scheduler.getMetrics();
+    EXPECT_EQ(m.submitted, 3);
+    EXPECT_EQ(m.completed, 2);
+    EXPECT_EQ(m.cancelled, 1);
+    EXPECT_EQ(m.searches, 9);
+    EXPECT_EQ(m.started[(int)ReviewPriority::Interactive], 1);
+    EXPECT_TRUE(m.nodesPerSecond() > 0);
+    scheduler.stop();
+
+    // Two bulk users at weights 2:1 share one engine about 2:1
+    order.clear();
+    ReviewScheduler::Options both;
+    both.max_running_bulk = 2;
+    ReviewScheduler shared(1, search, both);
+    shared.setUserWeight("heavy", 2.0);
+    std::vector<std::string> light_fens(7, live_start);
+    uint64_t a = shared.submit("heavy", ReviewPriority::Bulk, bulk_fens, {});
+    shared.submit("light", ReviewPriority::Bulk, light_fens, {});
+    shared.start();
+    for (int i = 0; i < 400 && (!shared.status(a, st) || st.state != ReviewJobState::Done); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    shared.stop();
+    int heavy_first = 0;
+    for (size_t i = 0; i < 6 && i < order.size(); i++) {
+        if (order[i] == bulk_start) heavy_first++;
+    }
+    EXPECT_TRUE(heavy_first >= 3 && heavy_first <= 5);
+
+    // A search the engine cannot finish fails the job: no results, and it
+    // is neither served nor counted as completed
+    auto dead = [&](size_t, const std::string&, const std::vector<std::string>&,
+                    const Engine::SearchLimits&, Engine::EngineResult&) { return false; };
+    ReviewScheduler broken(1, dead);
+    broken.start();
+    uint64_t lost = broken.submit("alice", ReviewPriority::Interactive, live_fens, {});
+    for (int i = 0; i < 400 && (!broken.status(lost, st) || st.state == ReviewJobState::Queued ||
+                                st.state == ReviewJobState::Running); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(st.state, ReviewJobState::Failed);
+    EXPECT_TRUE(st.results.empty());
+    EXPECT_TRUE(st.stats.failed > 0);
+    m = broken.getMetrics();
+    EXPECT_EQ(m.failed, 1);
+    EXPECT_EQ(m.completed, 0);
+    EXPECT_EQ(m.searches, 0);
+    broken.stop();
+}
+
+void test_analysis_scheduler_coalescing() {
+    // No engine process: the cache answers, which is enough to observe coalescing
+    Engine::StockfishClient sf("missing-engine.exe");
+    Engine::AnalysisCache cache;
+    sf.setCache(&cache);
+
+    std::string fenA = "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1";
+    std::string fenB = "rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2";
+    Engine::EngineResult deep;
+    deep.depth = 25; deep.score = 40; deep.pv = {"g1f3"};
+    cache.store(Engine::positionKey(fenA), deep);
+    cache.store(Engine::positionKey(fenB), deep);
+
+    Engine::AnalysisScheduler::Options opts;
+    opts.debounceMs = 20;
+    opts.multiPv = 1;
+    Engine::AnalysisScheduler scheduler(sf, opts);
+    std::mutex m;
+    std::vector<Engine::AnalysisUpdate> updates;
+    scheduler.setUpdateCallback([&](const Engine::AnalysisUpdate& u) {
+        std::lock_guard<std::mutex> lock(m);
+        updates.push_back(u);
+    });
+    scheduler.start();
+    scheduler.submit(fenA);
+    scheduler.submit(fenB);
+    uint64_t last = scheduler.submit(fenB);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    scheduler.stop();
+
+    EXPECT_EQ(updates.size(), 1);
+    EXPECT_EQ(updates[0].requestId, last);
+    EXPECT_TRUE(updates[0].final);
+    EXPECT_TRUE(updates[0].fromCache);
+    EXPECT_EQ(updates[0].info.best_move, "g1f3");
+
+    auto metrics = scheduler.getMetrics();
+    EXPECT_EQ(metrics.submitted, 3);
+    EXPECT_EQ(metrics.coalesced, 2);
+    EXPECT_EQ(metrics.cacheHits, 1);
+    EXPECT_EQ(metrics.firstEvalCount, 1);
+
+    // A MultiPV entry answers a MultiPV search in full, without searching
+    Engine::EngineResult lines = deep;
+    lines.lines = {{"g1f3", 40.0f, 40, false, 25, {"g1f3", "b8c6"}},
+                   {"d2d4", 30.0f, 30, false, 25, {"d2d4", "e5d4"}},
+                   {"f1c4", 25.0f, 25, false, 25, {"f1c4"}}};
+    cache.store(Engine::searchKey(Engine::positionKey(fenB), 3), lines);
+    opts.multiPv = 3;
+    Engine::AnalysisScheduler cached(sf, opts);
+    updates.clear();
+    cached.setUpdateCallback([&](const Engine::AnalysisUpdate& u) {
+        std::lock_guard<std::mutex> lock(m);
+        updates.push_back(u);
+    });
+    cached.start();
+    cached.submit(fenB);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    cached.stop();
+    EXPECT_EQ(updates.size(), 3);
+    EXPECT_EQ(updates[0].info.multipv, 2);
+    EXPECT_EQ(updates[0].info.pv[1], "e5d4");
+    EXPECT_EQ(updates[1].info.multipv, 3);
+    EXPECT_FALSE(updates[1].final);
+    EXPECT_EQ(updates[2].info.multipv, 1);
+    EXPECT_TRUE(updates[2].final);
+    EXPECT_EQ(cached.getMetrics().cacheHits, 1);
+    EXPECT_EQ(cached.getMetrics().searchesStarted, 0);
+
+    // A single-line result doesn't answer a MultiPV search
+    Engine::AnalysisScheduler multi(sf, opts);
+    updates.clear();
+    multi.setUpdateCallback([&](const Engine::AnalysisUpdate& u) {
+        std::lock_guard<std::mutex> lock(m);
+        updates.push_back(u);
+    });
+    multi.start();
+    multi.submit(fenA);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    multi.stop();
+    EXPECT_TRUE(updates.empty());
+    EXPECT_EQ(multi.getMetrics().cacheHits, 0);
+
+    // Nor does it answer the same placement reached through a repetition
+    std::string start = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    std::string fenC = Engine::applyUciMoves(start, {"g1f3", "g8f6", "f3g1", "f6g8"});
+    cache.store(Engine::positionKey(fenC), deep);
+    opts.multiPv = 1;
+    Engine::AnalysisScheduler repeated(sf, opts);
+    updates.clear();
+    repeated.setUpdateCallback([&](const Engine::AnalysisUpdate& u) {
+        std::lock_guard<std::mutex> lock(m);
+        updates.push_back(u);
+    });
+    repeated.start();
+    repeated.submit(start, {"g1f3", "g8f6", "f3g1", "f6g8"});
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    repeated.stop();
+    EXPECT_TRUE(updates.empty());
+    EXPECT_EQ(repeated.getMetrics().cacheHits, 0);
+}
+
+void test_command_batch() {
+    Engine::StockfishClient::CommandBatch batch;
+    batch.stop()
+         .position("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", {"e2e4", "e7e5"})
+         .go(12, 7);
+    Engine::SearchLimits limits;
+    limits.nodes = 5000;
+    limits.multiPv = 2;
+    batch.go(limits);
+    EXPECT_EQ(batch.data(),
+              "stop\n"
+              "position fen rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 moves e2e4 e7e5\n"
+              "go depth 12\n"
+              "setoption name MultiPV value 2\n"
+              "go nodes 5000\n");
+    batch.add("isready\n");
+    EXPECT_EQ(batch.data().substr(batch.data().size() - 8), "isready\n");
+
+    // Without a running engine nothing is written, and the batch is reset
+    Engine::StockfishClient sf("missing-engine.exe");
+    EXPECT_FALSE(sf.send(batch));
+    EXPECT_TRUE(batch.empty());
+    EXPECT_FALSE(sf.sendCommand("uci"));
+}
+
+void test_engine_supervisor_failure() {
+    // An engine that cannot be (re)started must fail fast instead of hanging
+    Engine::StockfishClient sf("missing-engine.exe");
+    Engine::EngineSupervisor::Options opts;
+    opts.requestTimeoutMs = 500;
+    Engine::EngineSupervisor supervisor(sf, opts);
+
+    Engine::EngineResult res;
+    EXPECT_FALSE(sf.isAlive());
+    EXPECT_FALSE(sf.ping(50));
+    EXPECT_FALSE(supervisor.analyze("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 10, res));
+
+    auto counters = supervisor.getCounters();
+    EXPECT_EQ(counters.failures, 1);
+    EXPECT_EQ(counters.failedSearches, 1);
+    EXPECT_EQ(counters.timeouts, 0);
+    EXPECT_EQ(counters.restarts, 0);
+    EXPECT_EQ(counters.failedRestarts, 1);
+    EXPECT_EQ(counters.requests, 0);
+}
+
+void test_engine_pool_split() {
+    Engine::EnginePool::Options opts;
+    opts.instances = 4;
+    opts.totalThreads = 32;
+    opts.totalHashMb = 1024;
+    Engine::EnginePool pool("missing-engine.exe", opts);
+    EXPECT_EQ(pool.threadsPerEngine(), 8);
+    EXPECT_EQ(pool.hashPerEngineMb(), 256);
+
+    // Instance count is capped so each engine keeps minHashMb of hash
+    Engine::EnginePool::Options wide;
+    wide.totalThreads = 64;
+    wide.totalHashMb = 256;
+    Engine::EnginePool widePool("missing-engine.exe", wide);
+    EXPECT_EQ(widePool.hashPerEngineMb(), 16);
+    EXPECT_EQ(widePool.threadsPerEngine(), 4);
+
+    // No engine could be started: nothing runs, nothing hangs
+    EXPECT_EQ(pool.start(), 0);
+    int calls = 0;
+    pool.forEach(10, [&](Engine::EngineSupervisor&, size_t) { calls++; });
+    EXPECT_EQ(calls, 0);
+}
+
+void test_app_model() {
+    using namespace Gui;
+    std::vector<std::vector<std::string>> analyzed;
+    int started_reviews = 0;
+    int cancelled_analysis = 0;
+    size_t restored_positions = 0;
+    ReviewSnapshot review;
+    review.results = std::make_shared<const std::vector<MoveReview>>();
+    review.report = std::make_shared<const ReviewReport>();
+
+    AppHooks hooks;
+    hooks.analyze = [&](const std::string&, const std::vector<std::string>& moves) {
+        analyzed.push_back(moves);
+        return (uint64_t)analyzed.size();
+    };
+    hooks.cancelAnalysis = [&]() { cancelled_analysis++; };
+    hooks.startReview = [&](const std::vector<std::string>&, const std::vector<std::string>&, const std::string&) { started_reviews++; };
+    hooks.restoreReview = [&](const std::vector<std::string>& fens, const std::vector<std::string>&, const std::string&) {
+        restored_positions = fens.size();
+        return false;
+    };
+    hooks.reviewSnapshot = [&]() { return review; };
+    AppModel model(hooks);
+    model.setVisibleRows(2);
+
+    auto click = [&](const char* sq) {
+        AppEvent e{AppEventType::SquareClicked};
+        e.square = stringToSquare(sq);
+        model.handle(e);
+    };
+    auto tick = [&]() { model.handle({AppEventType::Tick, 1.0f}); };
+
+    // Select, move, and the piece slides until the ticks finish it
+    uint64_t revision = model.snapshot().revision;
+    click("e2");
+    EXPECT_EQ(model.snapshot().selectedSq, stringToSquare("e2"));
+    click("e4");
+    AppSnapshot snap = model.snapshot();
+    EXPECT_TRUE(snap.anim.active);
+    EXPECT_EQ(snap.anim.dest, stringToSquare("e4"));
+    EXPECT_EQ(snap.sanMoves->size(), 1);
+    EXPECT_EQ(snap.selectedSq, SQUARE_NONE);
+    EXPECT_TRUE(snap.revision > revision);
+    EXPECT_EQ(analyzed.size(), 1);
+    EXPECT_EQ(analyzed.back()[0], "e2e4");
+    // No input while a piece is moving
+    click("e7");
+    EXPECT_EQ(model.snapshot().selectedSq, SQUARE_NONE);
+    tick();
+    EXPECT_FALSE(model.snapshot().anim.active);
+    // Idle ticks change nothing to redraw; engine output does
+    revision = model.snapshot().revision;
+    tick();
+    EXPECT_EQ(model.snapshot().revision, revision);
+    Engine::AnalysisUpdate update;
+    update.info.score = 35;
+    update.info.best_move = "e7e5";
+    model.onAnalysis(update);
+    EXPECT_TRUE(model.snapshot().revision > revision);
+    EXPECT_EQ(std::string(model.snapshot().analysis.bestMove), "e7e5");
+
+    // Navigating keeps the move list shared
+    auto moves = model.snapshot().sanMoves;
+    model.handle({AppEventType::Prev});
+    EXPECT_EQ(model.record().currentIndex, 0);
+    EXPECT_TRUE(model.snapshot().sanMoves == moves);
+    model.handle({AppEventType::Next});
+    EXPECT_EQ(model.record().currentIndex, 1);
+    EXPECT_EQ(analyzed.size(), 3);
+
+    // The paste dialog is modal and takes text only while open
+    AppEvent paste{AppEventType::SetPasteText};
+    paste.text = "1. e4 e5 2. Nf3 Nc6 3. Bb5 *";
+    model.handle(paste);
+    EXPECT_FALSE(model.snapshot().showPasteDialog);
+    model.handle({AppEventType::OpenPasteDialog});
+    model.handle(paste);
+    model.handle({AppEventType::First});
+    EXPECT_EQ(model.record().currentIndex, 1);
+    model.handle({AppEventType::SubmitPaste});
+    snap = model.snapshot();
+    EXPECT_FALSE(snap.showPasteDialog);
+    EXPECT_TRUE(snap.analysisActive);
+    EXPECT_EQ(snap.sanMoves->size(), 5);
+    EXPECT_EQ(snap.currentIndex, 5);
+    EXPECT_EQ(restored_positions, 6);
+    // Three rows of moves, two on screen: the last one is in view
+    EXPECT_EQ(snap.tableScroll, 1);
+    model.handle({AppEventType::First});
+    EXPECT_EQ(model.snapshot().tableScroll, 0);
+    EXPECT_EQ(model.board().getFen(), model.initialFen());
+    model.handle({AppEventType::Last});
+    EXPECT_EQ(model.record().currentIndex, 5);
+
+    // No interactive analysis while the review runs; it resumes when done
+    size_t before = analyzed.size();
+    model.handle({AppEventType::StartReview});
+    EXPECT_EQ(started_reviews, 1);
+    EXPECT_EQ(cancelled_analysis, 1);
+    EXPECT_TRUE(model.reviewState() == ReviewState::REVIEWING);
+    model.handle({AppEventType::Prev});
+    EXPECT_EQ(analyzed.size(), before);
+    click("e2");
+    EXPECT_EQ(model.snapshot().selectedSq, SQUARE_NONE);
+    review.complete = true;
+    tick();
+    EXPECT_TRUE(model.reviewState() == ReviewState::REVIEW_DONE);
+    EXPECT_EQ(analyzed.size(), before + 1);
+
+    model.handle({AppEventType::Reload});
+    EXPECT_FALSE(model.snapshot().analysisActive);
+    EXPECT_TRUE(model.reviewState() == ReviewState::IDLE);
+    EXPECT_EQ(model.snapshot().sanMoves->size(), 0);
+}
+
+void test_engine_status() {
+    using namespace Gui;
+    AppModel model(AppHooks{});
+
+    // Engine startup reports in as events, even over the paste dialog
+    EXPECT_TRUE(model.snapshot().engineStatus == EngineStatus::Starting);
+    model.handle({AppEventType::OpenPasteDialog});
+    AppEvent ready{AppEventType::EngineReady};
+    ready.text = "Stockfish 17";
+    uint64_t revision = model.snapshot().revision;
+    model.handle(ready);
+    AppSnapshot snap = model.snapshot();
+    EXPECT_TRUE(snap.engineStatus == EngineStatus::Ready);
+    EXPECT_EQ(*snap.engineMessage, "Stockfish 17");
+    EXPECT_TRUE(snap.revision > revision);
+
+    AppEvent failed{AppEventType::EngineFailed};
+    failed.text = "engine exited";
+    model.handle(failed);
+    snap = model.snapshot();
+    EXPECT_TRUE(snap.engineStatus == EngineStatus::Failed);
+    EXPECT_EQ(*snap.engineMessage, "engine exited");
+}
+
+void test_pv_formatter() {
+    using namespace Gui;
+    uint64_t requests = 0;
+    AppHooks hooks;
+    hooks.analyze = [&](const std::string&, const std::vector<std::string>&) { return ++requests; };
+    AppModel model(hooks);
+    AppEvent click{AppEventType::SquareClicked};
+    click.square = stringToSquare("e2");
+    model.handle(click);
+    click.square = stringToSquare("e4");
+    model.handle(click);
+    EXPECT_EQ(requests, 1u);
+
+    // Output of another request is shown, but not as this position's lines
+    Engine::AnalysisUpdate update;
+    update.requestId = 7;
+    update.info.score = 35;
+    update.info.best_move = "e7e5";
+    model.onAnalysis(update);
+    EXPECT_EQ(std::string(model.snapshot().analysis.bestMove), "e7e5");
+    EXPECT_FALSE(model.snapshot().analysisCurrent);
+
+    // MultiPV lines build up one info line at a time and come back in SAN
+    update.requestId = requests;
+    update.fen = "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq - 0 1";
+    update.info.depth = 12;
+    update.info.pv = {"e7e5", "g1f3", "b8c6", "f1b5"};
+    model.onAnalysis(update);
+    update.info.multipv = 2;
+    update.info.score = 20;
+    update.info.pv = {"c7c5", "g1f3"};
+    model.onAnalysis(update);
+    AppSnapshot snap = model.snapshot();
+    EXPECT_TRUE(snap.analysisCurrent);
+    EXPECT_EQ(snap.analysis.lineCount, 2);
+    EXPECT_EQ(snap.analysis.score, 35);
+    EXPECT_EQ(snap.analysis.lines[1].score, 20);
+    EXPECT_EQ(std::string(snap.analysis.lines[1].pv[0]), "c7c5");
+    for (int i = 0; i < 200 && model.snapshot().pvText.analysisSequence != snap.analysis.sequence; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    snap = model.snapshot();
+    EXPECT_EQ(snap.pvText.requestId, snap.analysis.requestId);
+    EXPECT_EQ(snap.pvText.lineCount, 2);
+    EXPECT_EQ(std::string(snap.pvText.lines[0]), "1... e5 2. Nf3 Nc6 3. Bb5");
+    EXPECT_EQ(std::string(snap.pvText.lines[1]), "1... c5 2. Nf3");
+}
+
+void test_snapshot_channel() {
+    struct Value { uint64_t seq; uint64_t check[8]; };
+    Gui::SnapshotChannel<Value> channel;
+    EXPECT_FALSE(channel.refresh());
+    EXPECT_EQ(channel.latest().seq, 0u);
+
+    channel.publish([](Value& v) { v.seq = 1; });
+    channel.publish([](Value& v) { v.seq = 2; });
+    // Only the newest value is kept
+    EXPECT_TRUE(channel.refresh());
+    EXPECT_EQ(channel.latest().seq, 2u);
+    EXPECT_FALSE(channel.refresh());
+    EXPECT_EQ(channel.latest().seq, 2u);
+
+    // A reader never sees a torn value or goes backwards
+    const uint64_t count = 200000;
+    std::thread producer([&]() {
+        for (uint64_t i = 3; i <= count; i++) {
+            channel.publish([&](Value& v) {
+                v.seq = i;
+                for (auto& c : v.check) c = i;
+            });
+        }
+    });
+    uint64_t last = 2;
+    while (last < count) {
+        if (!channel.refresh()) continue;
+        const Value& v = channel.latest();
+        EXPECT_TRUE(v.seq > last);
+        for (auto c : v.check) EXPECT_EQ(c, v.seq);
+        last = v.seq;
+    }
+    producer.join();
+}
+
+void test_frame_profiler() {
+    using Gui::FrameProfiler;
+    FrameProfiler prof;
+    EXPECT_TRUE(prof.framePercentile(0.5) == 0.0);
+
+    // Frames of 1..100 ms in shuffled order
+    for (int i = 0; i < 100; i++) prof.addFrame((double)((i * 37) % 100 + 1));
+    EXPECT_TRUE(std::fabs(prof.framePercentile(0.5) - 50.0) < 1e-9);
+    EXPECT_TRUE(std::fabs(prof.framePercentile(0.99) - 99.0) < 1e-9);
+
+    // Only the last HISTORY frames count
+    for (size_t i = 0; i < FrameProfiler::HISTORY; i++) prof.addFrame(2.0);
+    EXPECT_TRUE(prof.framePercentile(0.99) == 2.0);
+
+    // Spans of one name are summed within a frame
+    FrameProfiler scoped;
+    auto t0 = FrameProfiler::Clock::now();
+    scoped.startTrace();
+    scoped.record("draw", t0, t0 + std::chrono::milliseconds(3));
+    scoped.record("draw", t0, t0 + std::chrono::milliseconds(1));
+    std::thread([&]() { scoped.record("engine", t0, t0 + std::chrono::microseconds(500)); }).join();
+    scoped.addFrame(5.0);
+    scoped.stopTrace();
+    scoped.record("draw", t0, t0 + std::chrono::milliseconds(9));
+    scoped.addFrame(5.0);
+
+    auto stats = scoped.scopeStats();
+    EXPECT_EQ(stats.size(), 2u);
+    EXPECT_EQ(std::string(stats[0].name), "draw");
+    EXPECT_TRUE(std::fabs(stats[0].p50 - 4.0) < 1e-6);
+    EXPECT_TRUE(std::fabs(stats[0].p99 - 9.0) < 1e-6);
+    EXPECT_EQ(std::string(stats[1].name), "engine");
+
+    // Only spans recorded while tracing are exported, one thread id per thread
+    std::string json = scoped.traceJson();
+    EXPECT_TRUE(json.rfind("{\"traceEvents\":[", 0) == 0);
+    size_t events = 0;
+    for (size_t pos = 0; (pos = json.find("\"ph\":\"X\"", pos)) != std::string::npos; pos++) events++;
+    EXPECT_EQ(events, 3u);
+    EXPECT_TRUE(json.find("\"name\":\"draw\",\"ph\":\"X\",\"ts\":") != std::string::npos);
+    EXPECT_TRUE(json.find("\"dur\":3000,\"pid\":1,\"tid\":1}") != std::string::npos);
+    EXPECT_TRUE(json.find("\"dur\":500,\"pid\":1,\"tid\":2}") != std::string::npos);
+}
+
+void test_layout_geometry() {
+    using namespace Gui::Layout;
+
+    // The design size reproduces the fixed layout
+    Geometry g = computeGeometry(DESIGN_WIDTH, DESIGN_HEIGHT);
+    EXPECT_EQ(g.boardX, 80);
+    EXPECT_EQ(g.boardY, 80);
+    EXPECT_EQ(g.boardSize, 800);
+    EXPECT_EQ(g.squareSize, 100);
+    EXPECT_EQ(g.infoX, 960);
+    EXPECT_EQ(g.tableY, 200);
+    EXPECT_EQ(g.tableHeight, 600);
+    EXPECT_EQ(g.summaryY, 920);
+    EXPECT_EQ(g.visibleRows(), 22);
+
+    // Twice the size scales everything, board and fonts alike
+    Geometry big = computeGeometry(2 * DESIGN_WIDTH, 2 * DESIGN_HEIGHT);
+    EXPECT_EQ(big.squareSize, 200);
+    EXPECT_EQ(big.infoX, 1920);
+    EXPECT_EQ(big.font(18), 36);
+    EXPECT_EQ(big.visibleRows(), 22);
+
+    // Any size fits on screen, with whole-pixel squares
+    for (int w : { MIN_WIDTH, 1000, 1366, 1920, 3840 }) {
+        for (int h : { MIN_HEIGHT, 720, 1080, 2160 }) {
+            Geometry s = computeGeometry(w, h);
+            EXPECT_EQ(s.boardSize, s.squareSize * 8);
+            EXPECT_TRUE(s.evalBarX >= 0);
+            EXPECT_TRUE(s.infoX + s.panelWidth <= w);
+            EXPECT_TRUE(s.boardY + s.boardSize + s.btnMargin + s.btnPlaybackHeight <= h);
+            EXPECT_TRUE(s.summaryY + s.px(40) <= h);
+            EXPECT_TRUE(s.tableY + s.tableHeight <= s.graphY);
+            EXPECT_TRUE(s.font(14) >= 10);
+        }
+    }
+
+    // Spare width centers the content; spare height lengthens the table
+    Geometry wide = computeGeometry(1920, 960);
+    EXPECT_EQ(wide.boardSize, 800);
+    EXPECT_EQ(wide.boardX, 80 + 320);
+    Geometry tall = computeGeometry(1280, 1400);
+    EXPECT_EQ(tall.boardSize, 800);
+    EXPECT_TRUE(tall.visibleRows() > g.visibleRows());
+}
+
 int main() {
     std::cout << "Running tests...\n";
     test_squareToString_and_stringToSquare();
@@ -254,10 +1477,34 @@ int main() {
     test_perft();
     test_isCheckmate();
     test_addMove();
+    test_getMoveStrings();
     test_loadPgn();
+    test_pgn_split_and_tags();
     test_stockfish_integration();
     test_game_reviewer_classification();
+    test_game_reviewer_classify_game();
+    test_game_reviewer_win_probability();
+    test_game_reviewer_live_review();
+    test_game_reviewer_adaptive();
+    test_game_reviewer_reuse_best_move();
+    test_game_reviewer_node_budget();
+    test_review_report();
     test_game_reviewer_summary();
+    test_game_reviewer_search_failure();
+    test_parse_info_line();
+    test_analysis_cache();
+    test_review_store();
+    test_review_scheduler();
+    test_analysis_scheduler_coalescing();
+    test_command_batch();
+    test_engine_supervisor_failure();
+    test_engine_pool_split();
+    test_app_model();
+    test_pv_formatter();
+    test_engine_status();
+    test_snapshot_channel();
+    test_frame_profiler();
+    test_layout_geometry();
     std::cout << "All tests passed!\n";
     return 0;
 }